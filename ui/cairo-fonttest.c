@@ -25,7 +25,7 @@
 #include "colors.h"
 
 int main(void) {
-	struct cairo_swbuf_t *surface = create_swbuf(1000, 850);
+	struct cairo_swbuf_t *surface = create_swbuf(1000, 850, 32);
 	swbuf_clear(surface, COLOR_WHITE);
 
 	const unsigned int k = 224;
@@ -25,10 +25,100 @@
 #include <string.h>
 #include <stdarg.h>
 #include <math.h>
+#include <pthread.h>
 #include <fontconfig/fontconfig.h>
 #include "cairo.h"
+#include "fontcache.h"
+#include "textcache.h"
+#include "spritecache.h"
+#include "displaylist.h"
+#include "pixfill.h"
+#include "tablecache.h"
+
+struct render_profile_settings_t {
+	const char *name;
+	cairo_antialias_t antialias;
+	double tolerance;
+	cairo_antialias_t font_antialias;
+	cairo_hint_style_t hint_style;
+	cairo_hint_metrics_t hint_metrics;
+};
+
+static const struct render_profile_settings_t render_profiles[RENDER_PROFILE_COUNT] = {
+	[RENDER_PROFILE_QUALITY] = {
+		.name = "quality",
+		.antialias = CAIRO_ANTIALIAS_DEFAULT,
+		.tolerance = 0.1,
+		.font_antialias = CAIRO_ANTIALIAS_DEFAULT,
+		.hint_style = CAIRO_HINT_STYLE_DEFAULT,
+		.hint_metrics = CAIRO_HINT_METRICS_DEFAULT,
+	},
+	[RENDER_PROFILE_BALANCED] = {
+		.name = "balanced",
+		.antialias = CAIRO_ANTIALIAS_FAST,
+		.tolerance = 0.25,
+		.font_antialias = CAIRO_ANTIALIAS_GRAY,
+		.hint_style = CAIRO_HINT_STYLE_SLIGHT,
+		.hint_metrics = CAIRO_HINT_METRICS_ON,
+	},
+	[RENDER_PROFILE_FAST] = {
+		.name = "fast",
+		.antialias = CAIRO_ANTIALIAS_NONE,
+		.tolerance = 0.5,
+		.font_antialias = CAIRO_ANTIALIAS_GRAY,
+		.hint_style = CAIRO_HINT_STYLE_FULL,
+		.hint_metrics = CAIRO_HINT_METRICS_ON,
+	},
+};
+
+/* Font options are created once per profile; the font cache tells them apart
+ * by their address */
+static pthread_mutex_t render_profile_mutex = PTHREAD_MUTEX_INITIALIZER;
+static cairo_font_options_t *render_profile_font_options[RENDER_PROFILE_COUNT];
+static enum render_profile_t default_render_profile = RENDER_PROFILE_QUALITY;
+
+const char *render_profile_name(enum render_profile_t profile) {
+	return render_profiles[profile].name;
+}
+
+bool render_profile_parse(const char *name, enum render_profile_t *profile) {
+	for (unsigned int i = 0; i < RENDER_PROFILE_COUNT; i++) {
+		if (!strcmp(name, render_profiles[i].name)) {
+			*profile = i;
+			return true;
+		}
+	}
+	return false;
+}
+
+/* Profile that newly created buffers start out with */
+void render_profile_set_default(enum render_profile_t profile) {
+	default_render_profile = profile;
+}
+
+static const cairo_font_options_t *render_profile_get_font_options(enum render_profile_t profile) {
+	pthread_mutex_lock(&render_profile_mutex);
+	if (!render_profile_font_options[profile]) {
+		const struct render_profile_settings_t *settings = &render_profiles[profile];
+		cairo_font_options_t *options = cairo_font_options_create();
+		cairo_font_options_set_antialias(options, settings->font_antialias);
+		cairo_font_options_set_hint_style(options, settings->hint_style);
+		cairo_font_options_set_hint_metrics(options, settings->hint_metrics);
+		render_profile_font_options[profile] = options;
+	}
+	const cairo_font_options_t *options = render_profile_font_options[profile];
+	pthread_mutex_unlock(&render_profile_mutex);
+	return options;
+}
+
+/* Buffers are either 32 bpp ARGB or, to be copied verbatim onto 16 bpp
+ * displays, RGB565 */
+struct cairo_swbuf_t *create_swbuf(unsigned int width, unsigned int height, unsigned int bits_per_pixel) {
+	if ((bits_per_pixel != 32) && (bits_per_pixel != 16)) {
+		fprintf(stderr, "Cannot create software buffer with %u bpp.\n", bits_per_pixel);
+		return NULL;
+	}
 
-struct cairo_swbuf_t *create_swbuf(unsigned int width, unsigned int height) {
 	struct cairo_swbuf_t *buffer = calloc(sizeof(struct cairo_swbuf_t), 1);
 	if (!buffer) {
 		perror("calloc");
@@ -37,24 +127,151 @@ struct cairo_swbuf_t *create_swbuf(unsigned int width, unsigned int height) {
 
 	buffer->width = width;
 	buffer->height = height;
-	buffer->surface = cairo_image_surface_create(CAIRO_FORMAT_ARGB32, width, height);
+	buffer->bits_per_pixel = bits_per_pixel;
+	buffer->surface = cairo_image_surface_create((bits_per_pixel == 16) ? CAIRO_FORMAT_RGB16_565 : CAIRO_FORMAT_ARGB32, width, height);
 	if (!buffer->surface) {
 		free_swbuf(buffer);
 		return NULL;
 	}
 
 	buffer->ctx = cairo_create(buffer->surface);
+	damage_init(&buffer->damage, width, height);
+	swbuf_set_profile(buffer, default_render_profile);
 	return buffer;
 }
 
+/* Anything the buffer holds was rendered with the previous profile, so
+ * neither its contents nor its display list can be reused afterwards */
+void swbuf_set_profile(struct cairo_swbuf_t *swbuf, enum render_profile_t profile) {
+	const struct render_profile_settings_t *settings = &render_profiles[profile];
+	swbuf->profile = profile;
+	swbuf->font_options = render_profile_get_font_options(profile);
+	cairo_set_antialias(swbuf->ctx, settings->antialias);
+	cairo_set_tolerance(swbuf->ctx, settings->tolerance);
+	swbuf->base_layer_serial = 0;
+	damage_set_full(&swbuf->damage);
+	if (swbuf->displaylist) {
+		displaylist_invalidate(swbuf->displaylist);
+	}
+}
+
+/* Creates a buffer that draws onto the pixels of an existing one through its
+ * own Cairo context. The view must be freed before the buffer it refers to. */
+struct cairo_swbuf_t *create_swbuf_view(struct cairo_swbuf_t *swbuf) {
+	struct cairo_swbuf_t *view = calloc(sizeof(struct cairo_swbuf_t), 1);
+	if (!view) {
+		perror("calloc");
+		return NULL;
+	}
+
+	cairo_surface_flush(swbuf->surface);
+	view->width = swbuf->width;
+	view->height = swbuf->height;
+	view->bits_per_pixel = swbuf->bits_per_pixel;
+	view->surface = cairo_image_surface_create_for_data(cairo_image_surface_get_data(swbuf->surface), cairo_image_surface_get_format(swbuf->surface), swbuf->width, swbuf->height, cairo_image_surface_get_stride(swbuf->surface));
+	if (!view->surface) {
+		free_swbuf(view);
+		return NULL;
+	}
+
+	view->ctx = cairo_create(view->surface);
+	damage_init(&view->damage, view->width, view->height);
+	swbuf_set_profile(view, swbuf->profile);
+	return view;
+}
+
 static void swbuf_set_source_rgb(struct cairo_swbuf_t *surface, uint32_t bgcolor) {
 	cairo_set_source_rgb(surface->ctx, GET_R(bgcolor) / 255.0, GET_G(bgcolor) / 255.0, GET_B(bgcolor) / 255.0);
 }
 
+static bool swbuf_can_fill_directly(const struct cairo_swbuf_t *surface) {
+	cairo_format_t format = cairo_image_surface_get_format(surface->surface);
+	return (format == CAIRO_FORMAT_ARGB32) || (format == CAIRO_FORMAT_RGB24) || (format == CAIRO_FORMAT_RGB16_565);
+}
+
+static void swbuf_fill_directly(struct cairo_swbuf_t *surface, int x, int y, int width, int height, uint32_t color) {
+	/* Clip to the surface */
+	if (x < 0) {
+		width += x;
+		x = 0;
+	}
+	if (y < 0) {
+		height += y;
+		y = 0;
+	}
+	if (x + width > (int)surface->width) {
+		width = surface->width - x;
+	}
+	if (y + height > (int)surface->height) {
+		height = surface->height - y;
+	}
+	if ((width <= 0) || (height <= 0)) {
+		return;
+	}
+
+	uint8_t *data = cairo_image_surface_get_data(surface->surface);
+	const unsigned int stride = cairo_image_surface_get_stride(surface->surface);
+	cairo_surface_flush(surface->surface);
+	if (surface->bits_per_pixel == 16) {
+		pixfill_rect16(data, stride, x, y, width, height, RGB_TO_RGB565(color));
+	} else {
+		/* Opaque, therefore premultiplication does not change anything */
+		pixfill_rect32(data, stride, x, y, width, height, 0xff000000 | (color & 0xffffff));
+	}
+	cairo_surface_mark_dirty_rectangle(surface->surface, x, y, width, height);
+}
+
+/* Solid, axis-aligned rectangles bypass the path rasterizer. During display
+ * list replay, the clip region needs to be honored as well. */
+static void swbuf_fill_rect(struct cairo_swbuf_t *surface, int x, int y, int width, int height, uint32_t color) {
+	if (!surface->clip || surface->clip->full) {
+		swbuf_fill_directly(surface, x, y, width, height, color);
+		return;
+	}
+	for (unsigned int i = 0; i < surface->clip->count; i++) {
+		const struct damage_rect_t *clip = &surface->clip->rects[i];
+		int x1 = (x > clip->x) ? x : clip->x;
+		int y1 = (y > clip->y) ? y : clip->y;
+		int x2 = ((x + width) < (clip->x + (int)clip->width)) ? (x + width) : (clip->x + (int)clip->width);
+		int y2 = ((y + height) < (clip->y + (int)clip->height)) ? (y + height) : (clip->y + (int)clip->height);
+		if ((x2 > x1) && (y2 > y1)) {
+			swbuf_fill_directly(surface, x1, y1, x2 - x1, y2 - y1, color);
+		}
+	}
+}
+
 void swbuf_clear(struct cairo_swbuf_t *surface, uint32_t bgcolor) {
-	swbuf_set_source_rgb(surface, bgcolor);
-	cairo_rectangle(surface->ctx, 0, 0, surface->width, surface->height);
-	cairo_fill(surface->ctx);
+	if (swbuf_can_fill_directly(surface)) {
+		swbuf_fill_rect(surface, 0, 0, surface->width, surface->height, bgcolor);
+	} else {
+		swbuf_set_source_rgb(surface, bgcolor);
+		cairo_rectangle(surface->ctx, 0, 0, surface->width, surface->height);
+		cairo_fill(surface->ctx);
+	}
+	damage_set_full(&surface->damage);
+}
+
+/* Both buffers need to have the same dimensions */
+void swbuf_copy(struct cairo_swbuf_t *dest, const struct cairo_swbuf_t *src) {
+	cairo_surface_flush(src->surface);
+	cairo_surface_flush(dest->surface);
+	memcpy(cairo_image_surface_get_data(dest->surface), cairo_image_surface_get_data(src->surface), cairo_image_surface_get_stride(src->surface) * src->height);
+	cairo_surface_mark_dirty(dest->surface);
+}
+
+void swbuf_copy_rect(struct cairo_swbuf_t *dest, const struct cairo_swbuf_t *src, const struct damage_rect_t *rect) {
+	cairo_surface_flush(src->surface);
+	cairo_surface_flush(dest->surface);
+	const unsigned int stride = cairo_image_surface_get_stride(src->surface);
+	const unsigned int bytes_per_pixel = src->bits_per_pixel / 8;
+	const uint8_t *src_data = cairo_image_surface_get_data(src->surface) + (rect->y * stride) + (rect->x * bytes_per_pixel);
+	uint8_t *dest_data = cairo_image_surface_get_data(dest->surface) + (rect->y * stride) + (rect->x * bytes_per_pixel);
+	for (unsigned int y = 0; y < rect->height; y++) {
+		memcpy(dest_data, src_data, rect->width * bytes_per_pixel);
+		src_data += stride;
+		dest_data += stride;
+	}
+	cairo_surface_mark_dirty_rectangle(dest->surface, rect->x, rect->y, rect->width, rect->height);
 }
 
 uint32_t* swbuf_get_pixel_data(const struct cairo_swbuf_t *surface) {
@@ -62,8 +279,16 @@ uint32_t* swbuf_get_pixel_data(const struct cairo_swbuf_t *surface) {
 }
 
 uint32_t swbuf_get_pixel(const struct cairo_swbuf_t *surface, unsigned int x, unsigned int y) {
-	const uint32_t *data = swbuf_get_pixel_data(surface);
-	return data[(y * surface->width) + x] & 0xffffff;
+	const uint8_t *row = cairo_image_surface_get_data(surface->surface) + (y * cairo_image_surface_get_stride(surface->surface));
+	if (surface->bits_per_pixel == 16) {
+		return RGB565_TO_RGB(((const uint16_t*)row)[x]);
+	}
+	return ((const uint32_t*)row)[x] & 0xffffff;
+}
+
+/* True if the pixel data can be handed to a display as is */
+bool swbuf_is_packed(const struct cairo_swbuf_t *surface, unsigned int bits_per_pixel) {
+	return (surface->bits_per_pixel == bits_per_pixel) && (cairo_image_surface_get_stride(surface->surface) == surface->width * surface->bits_per_pixel / 8);
 }
 
 #ifdef CAIRO_DEBUG
@@ -86,42 +311,51 @@ static const char *yanchor_to_str(enum yanchor_t anchor) {
 }
 #endif
 
-static struct placement_t swbuf_calculate_placement(const struct cairo_swbuf_t *surface, const struct anchored_placement_t *anchored_placement, unsigned int obj_width, unsigned int obj_height) {
-	struct placement_t placement;
-
-	/* First we assume that we're placing the top left corner of the object
-	 * onto the surface */
+/* Places the destination anchor plus offset onto the surface. The result only
+ * depends on the surface size, not on the object, so it can be kept for as
+ * long as the surface size does not change. */
+void swbuf_resolve_placement(const struct cairo_swbuf_t *surface, const struct anchored_placement_t *anchored_placement, struct resolved_placement_t *resolved) {
 	switch (anchored_placement->dst_anchor.x) {
 		case XPOS_LEFT:
-			placement.top_left.x = 0;
+			resolved->origin.x = 0;
 			break;
 
 		case XPOS_CENTER:
-			placement.top_left.x = surface->width / 2;
+			resolved->origin.x = surface->width / 2;
 			break;
 
 		case XPOS_RIGHT:
-			placement.top_left.x = surface->width;
+			resolved->origin.x = surface->width;
 			break;
 	}
 
 	switch (anchored_placement->dst_anchor.y) {
 		case YPOS_TOP:
-			placement.top_left.y = 0;
+			resolved->origin.y = 0;
 			break;
 
 		case YPOS_CENTER:
-			placement.top_left.y = surface->height / 2;
+			resolved->origin.y = surface->height / 2;
 			break;
 
 		case YPOS_BOTTOM:
-			placement.top_left.y = surface->height;
+			resolved->origin.y = surface->height;
 			break;
 	}
 
-	/* Then, if the source wants to be placed somewhere else, we take that into
-	 * account */
-	switch (anchored_placement->src_anchor.x) {
+	resolved->origin.x += anchored_placement->xoffset;
+	resolved->origin.y += anchored_placement->yoffset;
+	resolved->src_x = anchored_placement->src_anchor.x;
+	resolved->src_y = anchored_placement->src_anchor.y;
+}
+
+/* Places an object of the given size with its own anchor on the resolved
+ * origin */
+struct placement_t swbuf_place_resolved(const struct resolved_placement_t *resolved, unsigned int obj_width, unsigned int obj_height) {
+	struct placement_t placement;
+	placement.top_left = resolved->origin;
+
+	switch (resolved->src_x) {
 		case XPOS_LEFT:
 			break;
 
@@ -134,7 +368,7 @@ static struct placement_t swbuf_calculate_placement(const struct cairo_swbuf_t *
 			break;
 	}
 
-	switch (anchored_placement->src_anchor.y) {
+	switch (resolved->src_y) {
 		case YPOS_TOP:
 			break;
 
@@ -147,17 +381,12 @@ static struct placement_t swbuf_calculate_placement(const struct cairo_swbuf_t *
 			break;
 	}
 
-	/* Finally we add the user offset */
-	placement.top_left.x += anchored_placement->xoffset;
-	placement.top_left.y += anchored_placement->yoffset;
-
-	/* And calculate the second set of coordinates */
 	placement.bottom_right.x = placement.top_left.x + obj_width;
 	placement.bottom_right.y = placement.top_left.y + obj_height;
 
 	/* Do we have an anchor point? */
 #if CAIRO_DEBUG
-	switch (anchored_placement->src_anchor.x) {
+	switch (resolved->src_x) {
 		case XPOS_LEFT:
 			placement.anchor.x = placement.top_left.x;
 			break;
@@ -170,7 +399,7 @@ static struct placement_t swbuf_calculate_placement(const struct cairo_swbuf_t *
 			placement.anchor.x = placement.bottom_right.x;
 			break;
 	}
-	switch (anchored_placement->src_anchor.y) {
+	switch (resolved->src_y) {
 		case YPOS_TOP:
 			placement.anchor.y = placement.top_left.y;
 			break;
@@ -184,6 +413,13 @@ static struct placement_t swbuf_calculate_placement(const struct cairo_swbuf_t *
 			break;
 	}
 #endif
+	return placement;
+}
+
+static struct placement_t swbuf_calculate_placement(const struct cairo_swbuf_t *surface, const struct anchored_placement_t *anchored_placement, unsigned int obj_width, unsigned int obj_height) {
+	struct resolved_placement_t resolved;
+	swbuf_resolve_placement(surface, anchored_placement, &resolved);
+	struct placement_t placement = swbuf_place_resolved(&resolved, obj_width, obj_height);
 
 #if CAIRO_DEBUG
 	printf("Abs position of %d x %d object: %s/%s corner is placed on %s/%s (%+d / %+d) => %d, %d\n",
@@ -205,6 +441,9 @@ void swbuf_render_table(struct cairo_swbuf_t *surface, const struct table_defini
 		table_width += table->column_widths[x];
 	}
 	struct placement_t table_placement = swbuf_calculate_placement(surface, &table->anchor, table_width, table_height);
+	if (table->cache && tablecache_render(table->cache, surface, table, ctx, table_placement.top_left.x, table_placement.top_left.y)) {
+		return;
+	}
 
 	unsigned int base_x = 0;
 	for (unsigned int x = 0; x < table->columns; x++) {
@@ -223,41 +462,163 @@ void swbuf_render_table(struct cairo_swbuf_t *surface, const struct table_defini
 	}
 }
 
-unsigned int swbuf_text(struct cairo_swbuf_t *surface, const struct font_placement_t *placement, const char *fmt, ...) {
-	char text[512];
-	va_list ap;
-	va_start(ap, fmt);
-	vsnprintf(text, sizeof(text), fmt, ap);
-	va_end(ap);
+/* Lays out a string of numeric characters with the font's precomputed glyphs
+ * at the given origin. Returns the number of glyphs and their total width. */
+static unsigned int swbuf_layout_number(const struct fontcache_entry_t *font, const char *text, double x, double y, cairo_glyph_t *glyphs, double *width) {
+	const struct fontcache_numeric_t *numeric = &font->numeric;
+	unsigned int count = 0;
+	double pen = 0;
+	for (const char *c = text; *c; c++) {
+		int index = fontcache_numeric_char_index(*c);
+		if (index < 0) {
+			continue;
+		}
+		double cell = (index < 10) ? numeric->digit_advance : numeric->advance[index];
+		if (glyphs) {
+			/* Center every glyph within its cell */
+			glyphs[count] = (cairo_glyph_t) {
+				.index = numeric->glyph_index[index],
+				.x = x + pen + ((cell - numeric->advance[index]) / 2),
+				.y = y,
+			};
+		}
+		count++;
+		pen += cell;
+	}
+	*width = pen;
+	return count;
+}
 
-	if (!placement->font_size) {
-		fprintf(stderr, "Warning: Font size zero. Not rendered: \"%s\"\n", text);
-		return 0;
+static void swbuf_draw_number_op(struct cairo_swbuf_t *surface, const struct displaylist_text_op_t *op) {
+	cairo_glyph_t glyphs[SWBUF_NUMBER_MAX_LENGTH];
+	double width;
+	unsigned int glyph_count = swbuf_layout_number(op->font, op->text, op->x, op->baseline_y, glyphs, &width);
+	cairo_set_scaled_font(surface->ctx, op->font->scaled_font);
+	swbuf_set_source_rgb(surface, op->color);
+	cairo_show_glyphs(surface->ctx, glyphs, glyph_count);
+}
+
+static void swbuf_draw_text_op(struct cairo_swbuf_t *surface, const struct displaylist_text_op_t *op) {
+	if (op->tabular) {
+		swbuf_draw_number_op(surface, op);
+		return;
 	}
 
-	cairo_text_extents_t extents;
-	cairo_select_font_face(surface->ctx, placement->font_face, CAIRO_FONT_SLANT_NORMAL, placement->font_bold ? CAIRO_FONT_WEIGHT_BOLD : CAIRO_FONT_WEIGHT_NORMAL);
-	cairo_set_font_size(surface->ctx, placement->font_size);
-	cairo_text_extents(surface->ctx, text, &extents);
-
-	cairo_font_extents_t font_extents;
-	cairo_font_extents(surface->ctx, &font_extents);
-
-	unsigned int assumed_width = extents.width;
-	if (placement->last_width) {
-		int diff = (int)assumed_width - (int)placement->last_width;
-		if (diff < 0) {
-			diff = -diff;
-		}
-		if (diff < placement->max_width_deviation) {
-			assumed_width = placement->last_width;
-		}
+	cairo_surface_t *sprite = op->cache_sprite ? spritecache_get(op->font, op->color, op->text, &op->extents) : NULL;
+	if (sprite) {
+		cairo_set_source_surface(surface->ctx, sprite, op->x - SPRITECACHE_PADDING, op->baseline_y + floor(op->extents.y_bearing) - SPRITECACHE_PADDING);
+		cairo_paint(surface->ctx);
+		cairo_surface_destroy(sprite);
+	} else {
+		cairo_set_scaled_font(surface->ctx, op->font->scaled_font);
+		swbuf_set_source_rgb(surface, op->color);
+		cairo_move_to(surface->ctx, op->x - op->extents.x_bearing, op->baseline_y);
+		cairo_show_text(surface->ctx, op->text);
+	}
+}
+
+static void swbuf_draw_rect_op(struct cairo_swbuf_t *surface, const struct displaylist_rect_op_t *op) {
+	if (op->fill && (op->round == 0) && swbuf_can_fill_directly(surface)) {
+		swbuf_fill_rect(surface, op->x, op->y, op->width, op->height, op->color);
+		return;
+	}
+
+	const int x1 = op->x;
+	const int y1 = op->y;
+	const int x2 = op->x + op->width;
+	const int y2 = op->y + op->height;
+	if (op->round == 0) {
+		cairo_rectangle(surface->ctx, x1, y1, op->width, op->height);
+	} else {
+		/* Calculate rounded path */
+		cairo_move_to(surface->ctx, x1 + op->round, y1);
+		cairo_line_to(surface->ctx, x2 - op->round, y1);
+		cairo_arc(surface->ctx, x2 - op->round, y1 + op->round, op->round, -M_PI / 2, 0);
+		cairo_line_to(surface->ctx, x2, y2 - op->round);
+		cairo_arc(surface->ctx, x2 - op->round, y2 - op->round, op->round, 0, M_PI / 2);
+		cairo_line_to(surface->ctx, x1 + op->round, y2);
+		cairo_arc(surface->ctx, x1 + op->round, y2 - op->round, op->round, M_PI / 2, M_PI);
+		cairo_line_to(surface->ctx, x1, y1 + op->round);
+		cairo_arc(surface->ctx, x1 + op->round, y1 + op->round, op->round, M_PI, M_PI * 3 / 2);
+	}
+	swbuf_set_source_rgb(surface, op->color);
+	if (op->fill) {
+		cairo_set_line_width(surface->ctx, 0);
+		cairo_fill(surface->ctx);
+	} else {
+		cairo_set_line_width(surface->ctx, 1);
+		cairo_stroke(surface->ctx);
 	}
+}
+
+static void swbuf_draw_circle_op(struct cairo_swbuf_t *surface, const struct displaylist_circle_op_t *op) {
+	swbuf_set_source_rgb(surface, op->color);
+	cairo_move_to(surface->ctx, op->x + op->radius, op->y);
+	cairo_arc(surface->ctx, op->x, op->y, op->radius, 0, 2 * M_PI);
+	cairo_fill(surface->ctx);
+}
+
+static void swbuf_draw_surface_op(struct cairo_swbuf_t *surface, const struct displaylist_surface_op_t *op) {
+	cairo_set_source_surface(surface->ctx, op->source, op->x, op->y);
+	for (unsigned int i = 0; i < op->coverage->count; i++) {
+		const struct damage_rect_t *rect = &op->coverage->rects[i];
+		cairo_rectangle(surface->ctx, op->x + rect->x, op->y + rect->y, rect->width, rect->height);
+	}
+	cairo_fill(surface->ctx);
+}
+
+void swbuf_draw_op(struct cairo_swbuf_t *surface, const struct displaylist_op_t *op) {
+	switch (op->type) {
+		case DL_OP_TEXT:
+			swbuf_draw_text_op(surface, &op->text);
+			break;
+
+		case DL_OP_RECT:
+			swbuf_draw_rect_op(surface, &op->rect);
+			break;
+
+		case DL_OP_CIRCLE:
+			swbuf_draw_circle_op(surface, &op->circle);
+			break;
+
+		case DL_OP_SURFACE:
+			swbuf_draw_surface_op(surface, &op->surface);
+			break;
+	}
+}
+
+/* In retained mode, the operation is only recorded; otherwise, it is drawn
+ * right away */
+static void swbuf_emit_op(struct cairo_swbuf_t *surface, const struct displaylist_op_t *op) {
+	if (surface->displaylist && surface->displaylist->recording) {
+		displaylist_record(surface->displaylist, op);
+	} else {
+		damage_add(&surface->damage, op->bbox.x, op->bbox.y, op->bbox.width, op->bbox.height);
+		swbuf_draw_op(surface, op);
+	}
+}
 
-	struct placement_t abs_placement = swbuf_calculate_placement(surface, &placement->placement, assumed_width, font_extents.ascent);
-	swbuf_set_source_rgb(surface, placement->font_color);
-	cairo_move_to(surface->ctx, abs_placement.top_left.x - extents.x_bearing, abs_placement.bottom_right.y);
-	cairo_show_text(surface->ctx, text);
+/* Places a text operation whose font and extents are resolved and emits it.
+ * Returns the width the text was placed with. */
+static unsigned int swbuf_emit_text_op(struct cairo_swbuf_t *surface, const struct resolved_placement_t *placement, uint32_t color, struct displaylist_op_t *op, const struct fontcache_entry_t *font, const cairo_text_extents_t *extents, unsigned int overhang) {
+	const cairo_font_extents_t font_extents = font->font_extents;
+	const unsigned int width = extents->width;
+
+	struct placement_t abs_placement = swbuf_place_resolved(placement, width, font_extents.ascent);
+	op->text.font = font;
+	op->text.color = color;
+	op->text.x = abs_placement.top_left.x;
+	op->text.baseline_y = abs_placement.bottom_right.y;
+	op->text.extents = *extents;
+
+	/* Ink extents plus some slack for antialiasing */
+	op->bbox = (struct damage_rect_t) {
+		.x = abs_placement.top_left.x - 2 - overhang,
+		.y = abs_placement.bottom_right.y + floor(extents->y_bearing) - 2,
+		.width = ceil(extents->width) + 4 + (2 * overhang),
+		.height = ceil(extents->height) + 5,
+	};
+	swbuf_emit_op(surface, op);
 
 #if CAIRO_DEBUG
 	swbuf_circle(surface, abs_placement.anchor.x, abs_placement.anchor.y, 4, COLOR_RED);
@@ -267,46 +628,209 @@ unsigned int swbuf_text(struct cairo_swbuf_t *surface, const struct font_placeme
 			.xoffset = abs_placement.top_left.x,
 			.yoffset = abs_placement.top_left.y,
 		},
-		.width = extents.width,
+		.width = extents->width,
 		.height = font_extents.ascent,
 		.color = COLOR_GREEN,
 	});
 #endif
-	return assumed_width;
+	return width;
+}
+
+unsigned int swbuf_vtext_at(struct cairo_swbuf_t *surface, const struct resolved_text_t *text, uint32_t color, const char *fmt, va_list ap) {
+	if (!text->font) {
+		return 0;
+	}
+	struct displaylist_op_t op = {
+		.type = DL_OP_TEXT,
+		.text = {
+			.cache_sprite = text->cache_sprite,
+		},
+	};
+	vsnprintf(op.text.text, sizeof(op.text.text), fmt, ap);
+
+	cairo_text_extents_t extents;
+	textcache_get_extents(text->font, op.text.text, &extents);
+	return swbuf_emit_text_op(surface, &text->placement, color, &op, text->font, &extents, 0);
+}
+
+/* Resolves everything about a font placement that does not depend on the
+ * text itself. Returns false if the text cannot be rendered. */
+bool swbuf_resolve_text(const struct cairo_swbuf_t *surface, const struct font_placement_t *placement, struct resolved_text_t *text) {
+	if (!placement->font_size) {
+		fprintf(stderr, "Warning: Font size zero for font \"%s\", not rendered.\n", placement->font_face);
+		return false;
+	}
+	text->font = fontcache_get(placement->font_face, placement->font_size, placement->font_bold, surface->font_options);
+	text->cache_sprite = placement->cache_sprite;
+	swbuf_resolve_placement(surface, &placement->placement, &text->placement);
+	return text->font != NULL;
+}
+
+/* Renders text with a placement that was resolved for the surface before */
+unsigned int swbuf_text_at(struct cairo_swbuf_t *surface, const struct resolved_text_t *text, uint32_t color, const char *fmt, ...) {
+	va_list ap;
+	va_start(ap, fmt);
+	unsigned int width = swbuf_vtext_at(surface, text, color, fmt, ap);
+	va_end(ap);
+	return width;
+}
+
+unsigned int swbuf_text(struct cairo_swbuf_t *surface, const struct font_placement_t *placement, const char *fmt, ...) {
+	struct resolved_text_t text;
+	if (!swbuf_resolve_text(surface, placement, &text)) {
+		return 0;
+	}
+	va_list ap;
+	va_start(ap, fmt);
+	unsigned int width = swbuf_vtext_at(surface, &text, placement->font_color, fmt, ap);
+	va_end(ap);
+	return width;
+}
+
+/* Formats value / 10^decimals into the buffer, which must hold at least
+ * SWBUF_NUMBER_MAX_LENGTH characters */
+static void format_fixed_point(char *dest, long value, unsigned int decimals, bool percent) {
+	char digits[24];
+	unsigned int digit_count = 0;
+	unsigned long magnitude = (value < 0) ? -(unsigned long)value : (unsigned long)value;
+	do {
+		digits[digit_count++] = '0' + (magnitude % 10);
+		magnitude /= 10;
+	} while (magnitude || (digit_count <= decimals));
+
+	if (value < 0) {
+		*dest++ = '-';
+	}
+	while (digit_count) {
+		if (decimals && (digit_count == decimals)) {
+			*dest++ = '.';
+		}
+		*dest++ = digits[--digit_count];
+	}
+	if (percent) {
+		*dest++ = '%';
+	}
+	*dest = 0;
+}
+
+/* Renders value / 10^decimals, optionally followed by a percent sign, without
+ * any text shaping. Digits have a fixed width, so the text's placement only
+ * changes when the number of digits does. */
+unsigned int swbuf_number_at(struct cairo_swbuf_t *surface, const struct resolved_text_t *text, uint32_t color, long value, unsigned int decimals, bool percent) {
+	if (!text->font) {
+		return 0;
+	}
+	struct displaylist_op_t op = {
+		.type = DL_OP_TEXT,
+		.text = {
+			.tabular = true,
+		},
+	};
+	if (decimals > 9) {
+		decimals = 9;
+	}
+	format_fixed_point(op.text.text, value, decimals, percent);
+
+	const struct fontcache_entry_t *font = text->font;
+	if (!font->numeric.valid) {
+		return swbuf_text_at(surface, text, color, "%s", op.text.text);
+	}
+
+	cairo_text_extents_t extents = {
+		.y_bearing = font->numeric.y_bearing,
+		.height = font->numeric.height,
+	};
+	swbuf_layout_number(font, op.text.text, 0, 0, NULL, &extents.width);
+	extents.x_advance = extents.width;
+	return swbuf_emit_text_op(surface, &text->placement, color, &op, font, &extents, font->numeric.overhang);
+}
+
+unsigned int swbuf_number(struct cairo_swbuf_t *surface, const struct font_placement_t *placement, long value, unsigned int decimals, bool percent) {
+	struct resolved_text_t text;
+	if (!swbuf_resolve_text(surface, placement, &text)) {
+		return 0;
+	}
+	return swbuf_number_at(surface, &text, placement->font_color, value, decimals, percent);
+}
+
+/* Draws a rectangle of the placement's size and style with its top left corner
+ * at an absolute position */
+void swbuf_rect_at(struct cairo_swbuf_t *surface, const struct rect_placement_t *placement, uint32_t color, const struct coordinate_t *top_left) {
+	swbuf_emit_op(surface, &(const struct displaylist_op_t) {
+		.type = DL_OP_RECT,
+		.bbox = {
+			.x = top_left->x - 1,
+			.y = top_left->y - 1,
+			.width = placement->width + 2,
+			.height = placement->height + 2,
+		},
+		.rect = {
+			.x = top_left->x,
+			.y = top_left->y,
+			.width = placement->width,
+			.height = placement->height,
+			.round = placement->round,
+			.color = color,
+			.fill = placement->fill,
+		},
+	});
 }
 
 void swbuf_rect(struct cairo_swbuf_t *surface, const struct rect_placement_t *placement) {
 	struct placement_t abs_placement = swbuf_calculate_placement(surface, &placement->placement, placement->width, placement->height);
+	swbuf_rect_at(surface, placement, placement->color, &abs_placement.top_left);
+}
 
-	if (placement->round == 0) {
-		cairo_rectangle(surface->ctx, abs_placement.top_left.x, abs_placement.top_left.y, placement->width, placement->height);
-	} else {
-		/* Calculate rounded path */
-		cairo_move_to(surface->ctx, abs_placement.top_left.x + placement->round, abs_placement.top_left.y);
-		cairo_line_to(surface->ctx, abs_placement.bottom_right.x - placement->round, abs_placement.top_left.y);
-		cairo_arc(surface->ctx, abs_placement.bottom_right.x - placement->round, abs_placement.top_left.y + placement->round, placement->round, -M_PI / 2, 0);
-		cairo_line_to(surface->ctx, abs_placement.bottom_right.x, abs_placement.bottom_right.y - placement->round);
-		cairo_arc(surface->ctx, abs_placement.bottom_right.x - placement->round, abs_placement.bottom_right.y - placement->round, placement->round, 0, M_PI / 2);
-		cairo_line_to(surface->ctx, abs_placement.top_left.x + placement->round, abs_placement.bottom_right.y);
-		cairo_arc(surface->ctx, abs_placement.top_left.x + placement->round, abs_placement.bottom_right.y - placement->round, placement->round, M_PI / 2, M_PI);
-		cairo_line_to(surface->ctx, abs_placement.top_left.x, abs_placement.top_left.y + placement->round);
-		cairo_arc(surface->ctx, abs_placement.top_left.x + placement->round, abs_placement.top_left.y + placement->round, placement->round, M_PI, M_PI * 3 / 2);
-	}
-	swbuf_set_source_rgb(surface, placement->color);
-	if (placement->fill) {
-		cairo_set_line_width(surface->ctx, 0);
-		cairo_fill(surface->ctx);
-	} else {
-		cairo_set_line_width(surface->ctx, 1);
-		cairo_stroke(surface->ctx);
+/* Composites the parts of the source surface that the coverage describes (in
+ * source coordinates) with the source's top left corner at (x, y). Whenever
+ * the source's contents change, the serial must change as well. */
+void swbuf_surface(struct cairo_swbuf_t *surface, cairo_surface_t *source, unsigned int serial, int x, int y, const struct damage_t *coverage) {
+	if (!coverage->count) {
+		return;
+	}
+	int x1 = coverage->rects[0].x, y1 = coverage->rects[0].y;
+	int x2 = x1 + (int)coverage->rects[0].width, y2 = y1 + (int)coverage->rects[0].height;
+	for (unsigned int i = 1; i < coverage->count; i++) {
+		const struct damage_rect_t *rect = &coverage->rects[i];
+		x1 = (rect->x < x1) ? rect->x : x1;
+		y1 = (rect->y < y1) ? rect->y : y1;
+		x2 = (rect->x + (int)rect->width > x2) ? rect->x + (int)rect->width : x2;
+		y2 = (rect->y + (int)rect->height > y2) ? rect->y + (int)rect->height : y2;
 	}
+	swbuf_emit_op(surface, &(const struct displaylist_op_t) {
+		.type = DL_OP_SURFACE,
+		.bbox = {
+			.x = x + x1,
+			.y = y + y1,
+			.width = x2 - x1,
+			.height = y2 - y1,
+		},
+		.surface = {
+			.source = source,
+			.serial = serial,
+			.x = x,
+			.y = y,
+			.coverage = coverage,
+		},
+	});
 }
 
 void swbuf_circle(struct cairo_swbuf_t *surface, unsigned int x, unsigned int y, unsigned int radius, uint32_t color) {
-	swbuf_set_source_rgb(surface, color);
-	cairo_move_to(surface->ctx, x + radius, y);
-	cairo_arc(surface->ctx, x, y, radius, 0, 2 * M_PI);
-	cairo_fill(surface->ctx);
+	swbuf_emit_op(surface, &(const struct displaylist_op_t) {
+		.type = DL_OP_CIRCLE,
+		.bbox = {
+			.x = (int)x - (int)radius - 1,
+			.y = (int)y - (int)radius - 1,
+			.width = (2 * radius) + 2,
+			.height = (2 * radius) + 2,
+		},
+		.circle = {
+			.x = x,
+			.y = y,
+			.radius = radius,
+			.color = color,
+		},
+	});
 }
 
 void swbuf_dump(struct cairo_swbuf_t *surface, const char *png_filename) {
@@ -317,13 +841,40 @@ void free_swbuf(struct cairo_swbuf_t *buffer) {
 	if (!buffer) {
 		return;
 	}
+	displaylist_free(buffer->displaylist);
 	cairo_destroy(buffer->ctx);
 	cairo_surface_destroy(buffer->surface);
 	free(buffer);
 }
 
-void cairo_addfont(const char *font_ttf_filename) {
-	FcConfigAppFontAddFile(FcConfigGetCurrent(), (uint8_t*)font_ttf_filename);
+/* Replaces fontconfig's configuration by an empty one, so that only fonts
+ * added by cairo_addfont() are known. This skips loading the system
+ * configuration and font caches and makes every font match run against a
+ * handful of fonts only. Must be called before Cairo resolves any font. */
+bool cairo_use_private_fontconfig(void) {
+	FcConfig *config = FcConfigCreate();
+	if (!config) {
+		fprintf(stderr, "Could not create private fontconfig configuration.\n");
+		return false;
+	}
+	if (!FcConfigSetCurrent(config)) {
+		fprintf(stderr, "Could not install private fontconfig configuration.\n");
+		FcConfigDestroy(config);
+		return false;
+	}
+#if FC_VERSION >= 21391
+	/* Newer fontconfig keeps its own reference to the current configuration */
+	FcConfigDestroy(config);
+#endif
+	return true;
+}
+
+bool cairo_addfont(const char *font_ttf_filename) {
+	if (!FcConfigAppFontAddFile(FcConfigGetCurrent(), (uint8_t*)font_ttf_filename)) {
+		fprintf(stderr, "Could not add font %s\n", font_ttf_filename);
+		return false;
+	}
+	return true;
 }
 
 void cairo_cleanup(void) {
@@ -331,6 +882,17 @@ void cairo_cleanup(void) {
 	 * to tell fontconfig to get its shit together even though it's Cairo's (!!)
 	 * transitive dependency. What a bunch of garbage.
 	 */
+	spritecache_flush();
+	textcache_flush();
+	fontcache_flush();
+	pthread_mutex_lock(&render_profile_mutex);
+	for (unsigned int i = 0; i < RENDER_PROFILE_COUNT; i++) {
+		if (render_profile_font_options[i]) {
+			cairo_font_options_destroy(render_profile_font_options[i]);
+			render_profile_font_options[i] = NULL;
+		}
+	}
+	pthread_mutex_unlock(&render_profile_mutex);
 	cairo_debug_reset_static_data();
 	FcFini();
 }
@@ -25,13 +25,37 @@
 
 #include <stdint.h>
 #include <stdbool.h>
+#include <stdarg.h>
 #include <cairo/cairo.h>
 #include "colors.h"
+#include "damage.h"
+
+#define SWBUF_NUMBER_MAX_LENGTH		32
+
+struct displaylist_t;
+struct displaylist_op_t;
+struct tablecache_t;
+struct fontcache_entry_t;
+
+/* Trade-off between rendering quality and speed, set per buffer */
+enum render_profile_t {
+	RENDER_PROFILE_QUALITY = 0,
+	RENDER_PROFILE_BALANCED = 1,
+	RENDER_PROFILE_FAST = 2,
+};
+#define RENDER_PROFILE_COUNT				3
 
 struct cairo_swbuf_t {
 	cairo_surface_t *surface;
 	cairo_t *ctx;
 	unsigned int width, height;
+	unsigned int bits_per_pixel;
+	enum render_profile_t profile;
+	const cairo_font_options_t *font_options;
+	struct damage_t damage;
+	unsigned int base_layer_serial;
+	struct displaylist_t *displaylist;
+	const struct damage_t *clip;
 };
 
 enum xanchor_t {
@@ -64,8 +88,7 @@ struct font_placement_t {
 	unsigned int font_size;
 	uint32_t font_color;
 	bool font_bold;
-	unsigned int last_width;
-	unsigned int max_width_deviation;
+	bool cache_sprite;
 };
 
 struct rect_placement_t {
@@ -88,6 +111,21 @@ struct placement_t {
 #endif
 };
 
+/* An anchored placement whose destination anchor and offset have already been
+ * placed onto a surface; only the object's own anchor remains to be applied
+ * once its size is known */
+struct resolved_placement_t {
+	struct coordinate_t origin;
+	enum xanchor_t src_x;
+	enum yanchor_t src_y;
+};
+
+struct resolved_text_t {
+	struct resolved_placement_t placement;
+	const struct fontcache_entry_t *font;
+	bool cache_sprite;
+};
+
 struct table_definition_t {
 	unsigned int columns, rows;
 	unsigned int *column_widths;
@@ -95,20 +133,41 @@ struct table_definition_t {
 	struct anchored_placement_t anchor;
 	struct font_placement_t font_default;
 	void (*rendering_callback)(char *dest_buf, unsigned int dest_buf_length, struct font_placement_t *placement, unsigned int x, unsigned int y, void *ctx);
+	struct tablecache_t *cache;
+	unsigned int version;
 };
 
 /*************** AUTO GENERATED SECTION FOLLOWS ***************/
-struct cairo_swbuf_t *create_swbuf(unsigned int width, unsigned int height);
+const char *render_profile_name(enum render_profile_t profile);
+bool render_profile_parse(const char *name, enum render_profile_t *profile);
+void render_profile_set_default(enum render_profile_t profile);
+struct cairo_swbuf_t *create_swbuf(unsigned int width, unsigned int height, unsigned int bits_per_pixel);
+void swbuf_set_profile(struct cairo_swbuf_t *swbuf, enum render_profile_t profile);
+struct cairo_swbuf_t *create_swbuf_view(struct cairo_swbuf_t *swbuf);
 void swbuf_clear(struct cairo_swbuf_t *surface, uint32_t bgcolor);
+void swbuf_copy(struct cairo_swbuf_t *dest, const struct cairo_swbuf_t *src);
+void swbuf_copy_rect(struct cairo_swbuf_t *dest, const struct cairo_swbuf_t *src, const struct damage_rect_t *rect);
 uint32_t* swbuf_get_pixel_data(const struct cairo_swbuf_t *surface);
 uint32_t swbuf_get_pixel(const struct cairo_swbuf_t *surface, unsigned int x, unsigned int y);
+bool swbuf_is_packed(const struct cairo_swbuf_t *surface, unsigned int bits_per_pixel);
+void swbuf_resolve_placement(const struct cairo_swbuf_t *surface, const struct anchored_placement_t *anchored_placement, struct resolved_placement_t *resolved);
+struct placement_t swbuf_place_resolved(const struct resolved_placement_t *resolved, unsigned int obj_width, unsigned int obj_height);
 void swbuf_render_table(struct cairo_swbuf_t *surface, const struct table_definition_t *table, void *ctx);
+unsigned int swbuf_vtext_at(struct cairo_swbuf_t *surface, const struct resolved_text_t *text, uint32_t color, const char *fmt, va_list ap);
+bool swbuf_resolve_text(const struct cairo_swbuf_t *surface, const struct font_placement_t *placement, struct resolved_text_t *text);
+unsigned int swbuf_text_at(struct cairo_swbuf_t *surface, const struct resolved_text_t *text, uint32_t color, const char *fmt, ...);
 unsigned int swbuf_text(struct cairo_swbuf_t *surface, const struct font_placement_t *placement, const char *fmt, ...);
+unsigned int swbuf_number_at(struct cairo_swbuf_t *surface, const struct resolved_text_t *text, uint32_t color, long value, unsigned int decimals, bool percent);
+unsigned int swbuf_number(struct cairo_swbuf_t *surface, const struct font_placement_t *placement, long value, unsigned int decimals, bool percent);
+void swbuf_draw_op(struct cairo_swbuf_t *surface, const struct displaylist_op_t *op);
+void swbuf_rect_at(struct cairo_swbuf_t *surface, const struct rect_placement_t *placement, uint32_t color, const struct coordinate_t *top_left);
 void swbuf_rect(struct cairo_swbuf_t *surface, const struct rect_placement_t *placement);
+void swbuf_surface(struct cairo_swbuf_t *surface, cairo_surface_t *source, unsigned int serial, int x, int y, const struct damage_t *coverage);
 void swbuf_circle(struct cairo_swbuf_t *surface, unsigned int x, unsigned int y, unsigned int radius, uint32_t color);
 void swbuf_dump(struct cairo_swbuf_t *surface, const char *png_filename);
 void free_swbuf(struct cairo_swbuf_t *buffer);
-void cairo_addfont(const char *font_ttf_filename);
+bool cairo_use_private_fontconfig(void);
+bool cairo_addfont(const char *font_ttf_filename);
 void cairo_cleanup(void);
 /***************  AUTO GENERATED SECTION ENDS   ***************/
 
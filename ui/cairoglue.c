@@ -22,9 +22,16 @@
 
 #include "cairoglue.h"
 
+/* Pixel format in which software buffers are rendered so that they can be
+ * copied onto the display without conversion */
+unsigned int swbuf_bits_per_pixel_for_display(const struct display_t *display) {
+	return (display->bits_per_pixel == 16) ? 16 : 32;
+}
+
 void blit_swbuf_on_display(struct cairo_swbuf_t *swbuf, struct display_t *target) {
 	/* Try to fast blit first */
-	if ((target->calltable->blit_buffer) && target->calltable->blit_buffer(target, swbuf_get_pixel_data(swbuf), swbuf->width, swbuf->height)) {
+	cairo_surface_flush(swbuf->surface);
+	if (target->calltable->blit_buffer && swbuf_is_packed(swbuf, target->bits_per_pixel) && target->calltable->blit_buffer(target, swbuf_get_pixel_data(swbuf), swbuf->width, swbuf->height)) {
 		/* Success! */
 		return;
 	}
@@ -37,3 +44,25 @@ void blit_swbuf_on_display(struct cairo_swbuf_t *swbuf, struct display_t *target
 		}
 	}
 }
+
+void blit_swbuf_rects_on_display(struct cairo_swbuf_t *swbuf, struct display_t *target, const struct damage_t *damage) {
+	if (damage->full) {
+		blit_swbuf_on_display(swbuf, target);
+		return;
+	}
+
+	cairo_surface_flush(swbuf->surface);
+	if (target->calltable->blit_rects && swbuf_is_packed(swbuf, target->bits_per_pixel) && target->calltable->blit_rects(target, swbuf_get_pixel_data(swbuf), swbuf->width, swbuf->height, damage)) {
+		return;
+	}
+
+	for (unsigned int i = 0; i < damage->count; i++) {
+		const struct damage_rect_t *rect = &damage->rects[i];
+		for (unsigned int y = rect->y; y < rect->y + rect->height; y++) {
+			for (unsigned int x = rect->x; x < rect->x + rect->width; x++) {
+				uint32_t rgb = swbuf_get_pixel(swbuf, x, y);
+				display_put_pixel(target, x, y, rgb);
+			}
+		}
+	}
+}
@@ -27,7 +27,9 @@
 #include "cairo.h"
 
 /*************** AUTO GENERATED SECTION FOLLOWS ***************/
+unsigned int swbuf_bits_per_pixel_for_display(const struct display_t *display);
 void blit_swbuf_on_display(struct cairo_swbuf_t *swbuf, struct display_t *target);
+void blit_swbuf_rects_on_display(struct cairo_swbuf_t *swbuf, struct display_t *target, const struct damage_t *damage);
 /***************  AUTO GENERATED SECTION ENDS   ***************/
 
 #endif
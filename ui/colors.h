@@ -34,6 +34,12 @@
 
 #define MK_RGB(r, g, b)				((UINT8(r) << 16) | (UINT8(g) << 8) | (UINT8(b) << 0))
 
+#define RGB_TO_RGB565(rgb)			(((GET_R(rgb) >> 3) << 11) | ((GET_G(rgb) >> 2) << 5) | ((GET_B(rgb) >> 3) << 0))
+#define RGB565_GET_R(pixel)			((((pixel) >> 11) & 0x1f) * 255 / 31)
+#define RGB565_GET_G(pixel)			((((pixel) >> 5) & 0x3f) * 255 / 63)
+#define RGB565_GET_B(pixel)			((((pixel) >> 0) & 0x1f) * 255 / 31)
+#define RGB565_TO_RGB(pixel)		MK_RGB(RGB565_GET_R(pixel), RGB565_GET_G(pixel), RGB565_GET_B(pixel))
+
 #define COLOR_BLACK					MK_RGB(0x00, 0x00, 0x00)
 #define COLOR_RED					MK_RGB(0xff, 0x00, 0x00)
 #define COLOR_GREEN					MK_RGB(0x00, 0xff, 0x00)
@@ -24,17 +24,26 @@
 #include <unistd.h>
 #include <stdlib.h>
 #include <string.h>
+#include <inttypes.h>
 #include "display.h"
 #include "display_fb.h"
 #include "cairo.h"
 #include "cairoglue.h"
 #include "display_sdl.h"
+#include "display_headless.h"
 #include "historian.h"
 #include "tools.h"
-#include "isleep.h"
+#include "framesched.h"
+#include "fontcache.h"
+#include "textcache.h"
+#include "spritecache.h"
 #include "signals.h"
 #include "cyberblades-ui.h"
 #include "renderer_fullhd.h"
+#include "swapchain.h"
+#include "perfstat.h"
+#include "tilerender.h"
+#include "splash.h"
 
 static bool string_is(const char *str1, const char *str2) {
 	if (!str1 || !str2) {
@@ -94,41 +103,124 @@ static void parse_player_stats(struct player_stats_t *stats, struct jsondom_t *s
 	stats->total_max_score = jsondom_get_dict_int(stat_json, "total_max_score");
 }
 
+static void server_state_lock(struct server_state_t *server_state) {
+	if (pthread_mutex_trylock(&server_state->shared_data_mutex) == 0) {
+		server_state->lock_stats.acquisitions++;
+		return;
+	}
+
+	/* Contended, account for the time we spend waiting */
+	uint64_t t0 = now_monotonic_ns();
+	pthread_mutex_lock(&server_state->shared_data_mutex);
+	server_state->lock_stats.acquisitions++;
+	server_state->lock_stats.contended++;
+	server_state->lock_stats.wait_ns += now_monotonic_ns() - t0;
+}
+
+static void server_state_unlock(struct server_state_t *server_state) {
+	pthread_mutex_unlock(&server_state->shared_data_mutex);
+}
+
+/* Must be called with the shared data mutex held; since that serializes all
+ * writers, the seqlock only ever sees a single writer. */
+static void server_state_publish(struct server_state_t *server_state) {
+	seqlock_write_begin(&server_state->published_seqlock);
+	server_state->published = server_state->state;
+	seqlock_write_end(&server_state->published_seqlock);
+}
+
+/* Must be called with the shared data mutex held after anything that is
+ * visible on screen has been modified */
+static void server_state_changed(struct server_state_t *server_state) {
+	server_state->state.generation++;
+	server_state_publish(server_state);
+	framesched_interrupt(&server_state->framesched);
+}
+
+/* Lock-free, may be called from any thread */
+static void server_state_snapshot(struct server_state_t *server_state, struct render_state_t *snapshot) {
+	unsigned int sequence;
+	do {
+		sequence = seqlock_read_begin(&server_state->published_seqlock);
+		*snapshot = server_state->published;
+	} while (seqlock_read_retry(&server_state->published_seqlock, sequence));
+}
+
+static void dump_statistics(struct server_state_t *server_state) {
+	const unsigned int total = server_state->frame_stats.rendered + server_state->frame_stats.skipped;
+	fprintf(stderr, "Frames rendered: %u, skipped: %u (%.1f%% skipped)\n", server_state->frame_stats.rendered, server_state->frame_stats.skipped, total ? 100. * server_state->frame_stats.skipped / total : 0);
+	const struct present_stats_t *present_stats = &server_state->present_stats;
+	fprintf(stderr, "Frames presented: %u, %u full, %.1f%% of pixels damaged on average\n", present_stats->frames, present_stats->full_frames, present_stats->total_pixels ? 100. * present_stats->damaged_pixels / present_stats->total_pixels : 0);
+	if (server_state->swapchain) {
+		struct swapchain_stats_t swapchain_stats;
+		swapchain_get_stats(server_state->swapchain, &swapchain_stats);
+		fprintf(stderr, "Swap chain depth %u: %u frames queued, %u presented, %u dropped\n", server_state->swapchain->depth, swapchain_stats.queued, swapchain_stats.presented, swapchain_stats.dropped);
+	}
+
+	struct framesched_stats_t sched_stats;
+	framesched_get_stats(&server_state->framesched, &sched_stats);
+	fprintf(stderr, "Frame pacing: currently %u fps, %u deadlines, %u early wakeups, %u missed deadlines, jitter avg %.3f ms max %.3f ms\n", sched_stats.current_fps, sched_stats.deadlines, sched_stats.interrupts, sched_stats.missed_deadlines, sched_stats.deadlines ? sched_stats.jitter_sum_ns / 1e6 / sched_stats.deadlines : 0, sched_stats.jitter_max_ns / 1e6);
+	fprintf(stderr, "Render profile: %s (%s), %u downgrades\n", render_profile_name(server_state->profilegov.profile), server_state->profilegov.automatic ? "automatic" : "fixed", server_state->profilegov.downgrades);
+	if (server_state->historian) {
+		const struct historian_stats_t *historian_stats = &server_state->historian->stats;
+		fprintf(stderr, "Historian: %u messages received, %u status messages coalesced (%.1f%%)\n", historian_stats->received, historian_stats->coalesced, historian_stats->received ? 100. * historian_stats->coalesced / historian_stats->received : 0);
+	}
+	struct fontcache_stats_t fontcache_stats;
+	fontcache_get_stats(&fontcache_stats);
+	fprintf(stderr, "Font cache: %u fonts, %llu hits, %llu misses\n", fontcache_stats.entries, fontcache_stats.hits, fontcache_stats.misses);
+	struct textcache_stats_t textcache_stats;
+	textcache_get_stats(&textcache_stats);
+	fprintf(stderr, "Text extents cache: %u of %u entries, %llu hits, %llu misses, %llu evictions, %llu uncacheable\n", textcache_stats.entries, TEXTCACHE_ENTRY_COUNT, textcache_stats.hits, textcache_stats.misses, textcache_stats.evictions, textcache_stats.uncacheable);
+	struct spritecache_stats_t spritecache_stats;
+	spritecache_get_stats(&spritecache_stats);
+	fprintf(stderr, "Sprite cache: %u sprites, %u of %u kiB, %llu hits, %llu misses, %llu evictions\n", spritecache_stats.entries, spritecache_stats.size_bytes / 1024, SPRITECACHE_BUDGET_BYTES / 1024, spritecache_stats.hits, spritecache_stats.misses, spritecache_stats.evictions);
+	struct renderer_stats_t renderer_stats;
+	renderer_full_hd_get_stats(&renderer_stats);
+	fprintf(stderr, "Static layers: %u rebuilds, %u reuses, %.1f Mpixels restored\n", renderer_stats.static_layer_rebuilds, renderer_stats.static_layer_reuses, renderer_stats.restored_pixels / 1e6);
+	fprintf(stderr, "Layouts: %u resolutions\n", renderer_stats.layout_resolutions);
+	fprintf(stderr, "Highscore table: %llu unchanged, %llu cells reused, %llu cells redrawn\n", renderer_stats.highscore_table.table_hits, renderer_stats.highscore_table.cell_hits, renderer_stats.highscore_table.cell_misses);
+	if (renderer_stats.recorded_ops) {
+		fprintf(stderr, "Display list: %llu operations recorded, %llu replayed (%.1f%%)\n", renderer_stats.recorded_ops, renderer_stats.replayed_ops, 100. * renderer_stats.replayed_ops / renderer_stats.recorded_ops);
+	}
+	fprintf(stderr, "Shared data lock: %llu acquisitions, %llu contended, %.3f ms spent waiting\n", server_state->lock_stats.acquisitions, server_state->lock_stats.contended, server_state->lock_stats.wait_ns / 1e6);
+	perfstat_dump(stderr);
+}
+
 static void set_player(struct server_state_t *server_state, const char *new_player) {
 	historian_command(server_state->historian, "set_player", "\"player\":\"%s\"", new_player);
 }
 
 static void request_player_information(struct server_state_t *server_state) {
-	historian_command(server_state->historian, "playerinfo", "\"player\":\"%s\"", server_state->player.name);
+	historian_command(server_state->historian, "playerinfo", "\"player\":\"%s\"", server_state->state.player.name);
 }
 
 static void event_handle_historian_status(struct server_state_t *server_state, struct jsondom_t *json) {
 	struct jsondom_t *json_connection = jsondom_get_dict_dict(json, "connection");
 	struct jsondom_t *current_game = jsondom_get_dict_dict(json, "current_game");
 	if (json_connection) {
-		if (strncpycmp(server_state->player.name, jsondom_get_dict_str(json_connection, "current_player"), sizeof(server_state->player.name))) {
+		if (strncpycmp(server_state->state.player.name, jsondom_get_dict_str(json_connection, "current_player"), sizeof(server_state->state.player.name))) {
 			/* Player name has changed */
 			request_player_information(server_state);
 		}
-		server_state->connected_to_beatsaber = jsondom_get_dict_bool(json_connection, "connected_to_beatsaber");
+		server_state->state.connected_to_beatsaber = jsondom_get_dict_bool(json_connection, "connected_to_beatsaber");
 
 		bool in_game = current_game != NULL;
 		if (in_game) {
-			server_state->ui_screen = GAME_SCREEN;
-			server_state->screen_shown_at_ts = now();
+			server_state->state.ui_screen = GAME_SCREEN;
+			server_state->state.screen_shown_at_ts = now();
 		} else {
-			if (server_state->ui_screen == GAME_SCREEN) {
+			if (server_state->state.ui_screen == GAME_SCREEN) {
 				/* Was playing a game, now back to main screen: Update
 				 * highscores! */
 				request_player_information(server_state);
 			}
-			server_state->ui_screen = MAIN_SCREEN;
-			server_state->screen_shown_at_ts = now();
+			server_state->state.ui_screen = MAIN_SCREEN;
+			server_state->state.screen_shown_at_ts = now();
 		}
 	}
 
-	parse_game_info(&server_state->current_song, current_game);
-	isleep_interrupt(&server_state->isleep);
+	parse_game_info(&server_state->state.current_song, current_game);
+	server_state_changed(server_state);
 }
 
 static void parse_highscore_entry(struct highscore_entry_t *entry, struct jsondom_t *json) {
@@ -141,47 +233,50 @@ static void parse_highscore_entry(struct highscore_entry_t *entry, struct jsondo
 static void event_handle_historian_playerinfo(struct server_state_t *server_state, struct jsondom_t *json) {
 	jsondom_dump(json);
 	const char *player = jsondom_get_dict_str(json, "player");
-	if (!player || strcmp(player, server_state->player.name)) {
+	if (!player || strcmp(player, server_state->state.player.name)) {
 		/* No player set or different player given */
 		return;
 	}
-	parse_player_stats(&server_state->player.today, jsondom_get_dict_dict(json, "today"));
-	parse_player_stats(&server_state->player.alltime, jsondom_get_dict_dict(json, "alltime"));
+	parse_player_stats(&server_state->state.player.today, jsondom_get_dict_dict(json, "today"));
+	parse_player_stats(&server_state->state.player.alltime, jsondom_get_dict_dict(json, "alltime"));
 
 	struct jsondom_t *highscore = jsondom_get_dict_dict(json, "highscore");
 	struct jsondom_t *highscore_song_key = jsondom_get_dict_dict(highscore, "song_key");
 	if (highscore_song_key) {
-		strncpycmp(server_state->highscores.song_key.song_author, jsondom_get_dict_str(highscore_song_key, "song_author"), sizeof(server_state->highscores.song_key.song_author));
-		strncpycmp(server_state->highscores.song_key.song_title, jsondom_get_dict_str(highscore_song_key, "song_title"), sizeof(server_state->highscores.song_key.song_title));
-		strncpycmp(server_state->highscores.song_key.level_author, jsondom_get_dict_str(highscore_song_key, "level_author"), sizeof(server_state->highscores.song_key.level_author));
-		server_state->highscores.song_key.difficulty = jsondom_get_dict_int(highscore_song_key, "difficulty");
+		strncpycmp(server_state->state.highscores.song_key.song_author, jsondom_get_dict_str(highscore_song_key, "song_author"), sizeof(server_state->state.highscores.song_key.song_author));
+		strncpycmp(server_state->state.highscores.song_key.song_title, jsondom_get_dict_str(highscore_song_key, "song_title"), sizeof(server_state->state.highscores.song_key.song_title));
+		strncpycmp(server_state->state.highscores.song_key.level_author, jsondom_get_dict_str(highscore_song_key, "level_author"), sizeof(server_state->state.highscores.song_key.level_author));
+		server_state->state.highscores.song_key.difficulty = jsondom_get_dict_int(highscore_song_key, "difficulty");
 	}
 
 	struct jsondom_t *highscore_table = jsondom_get_dict_array(highscore, "table");
 	if (highscore_table) {
 		unsigned int highscore_entry_count = highscore_table->element.array.element_cnt;
-		server_state->highscores.entry_count = (highscore_entry_count > MAX_HIGHSCORE_ENTRY_COUNT) ? MAX_HIGHSCORE_ENTRY_COUNT : highscore_entry_count;
-		for (unsigned int i = 0; i < server_state->highscores.entry_count; i++) {
+		server_state->state.highscores.entry_count = (highscore_entry_count > MAX_HIGHSCORE_ENTRY_COUNT) ? MAX_HIGHSCORE_ENTRY_COUNT : highscore_entry_count;
+		for (unsigned int i = 0; i < server_state->state.highscores.entry_count; i++) {
 			struct jsondom_t *highscore_entry = jsondom_get_array_item(highscore_table, i);
-			parse_highscore_entry(&server_state->highscores.entries[i], highscore_entry);
+			parse_highscore_entry(&server_state->state.highscores.entries[i], highscore_entry);
 		}
 	} else {
-		server_state->highscores.entry_count = 0;
+		server_state->state.highscores.entry_count = 0;
 	}
+	server_state->state.highscores.version++;
+	server_state_changed(server_state);
 }
 
 static void event_callback(enum ui_eventtype_t event_type, void *vevent, void *ctx) {
 	struct server_state_t *server_state = (struct server_state_t*)ctx;
 
-	pthread_mutex_lock(&server_state->shared_data_mutex);
+	server_state_lock(server_state);
 
 	if (event_type == EVENT_QUIT) {
+		dump_statistics(server_state);
 		exit(EXIT_SUCCESS);
 	} else if (event_type == EVENT_KEYPRESS) {
 		struct ui_event_keypress_t *event = (struct ui_event_keypress_t*)vevent;
 		if (event->key == SDLK_BACKSPACE) {
-			char new_name[sizeof(server_state->player.name)];
-			strcpy(new_name, server_state->player.name);
+			char new_name[sizeof(server_state->state.player.name)];
+			strcpy(new_name, server_state->state.player.name);
 			int len = strlen(new_name);
 			if (len) {
 				new_name[len - 1] = 0;
@@ -190,17 +285,18 @@ static void event_callback(enum ui_eventtype_t event_type, void *vevent, void *c
 		}
 	} else if (event_type == EVENT_TEXTDATA) {
 		struct ui_event_textdata_t *event = (struct ui_event_textdata_t*)vevent;
-		int len = strlen(server_state->player.name);
+		int len = strlen(server_state->state.player.name);
 		int add_len = strlen(event->text);
-		if (len + add_len < sizeof(server_state->player.name)) {
-			char new_name[sizeof(server_state->player.name)];
-			strcpy(new_name, server_state->player.name);
+		if (len + add_len < sizeof(server_state->state.player.name)) {
+			char new_name[sizeof(server_state->state.player.name)];
+			strcpy(new_name, server_state->state.player.name);
 			strcat(new_name, event->text);
 			set_player(server_state, new_name);
 		}
 	} else if (event_type == EVENT_HISTORIAN_MESSAGE) {
 		struct ui_event_historian_msg_t *event = (struct ui_event_historian_msg_t*)vevent;
 //		jsondom_dump(event->json);
+		server_state->state.historian_msgno = event->msgno;
 
 		const char *msgtype = jsondom_get_dict_str(event->json, "msgtype");
 		if (msgtype) {
@@ -216,30 +312,304 @@ static void event_callback(enum ui_eventtype_t event_type, void *vevent, void *c
 			fprintf(stderr, "No 'msgtype' present:\n");
 			jsondom_dump(event->json);
 		}
+	} else if (event_type == EVENT_DUMP_STATS) {
+		dump_statistics(server_state);
 	} else if (event_type == EVENT_HISTORIAN_STATECHG) {
 		struct ui_event_historian_statechg_t *event = (struct ui_event_historian_statechg_t*)vevent;
 		if (event->new_state == UNCONNECTED) {
-			server_state->connected_to_beatsaber = false;
-			server_state->ui_screen = MAIN_SCREEN;
-			server_state->screen_shown_at_ts = now();
-			isleep_interrupt(&server_state->isleep);
+			server_state->state.connected_to_beatsaber = false;
+			server_state->state.ui_screen = MAIN_SCREEN;
+			server_state->state.screen_shown_at_ts = now();
 		}
+		server_state->state.historian_state = event->new_state;
+		server_state_changed(server_state);
 	}
-	pthread_mutex_unlock(&server_state->shared_data_mutex);
+	server_state_unlock(server_state);
+}
+
+static void* render_thread_fnc(void *vserver_state) {
+	struct server_state_t *server_state = (struct server_state_t*)vserver_state;
+	struct render_state_t snapshot;
+	bool have_frame = false;
+	unsigned int rendered_generation = 0;
+	while (server_state->running) {
+		server_state_snapshot(server_state, &snapshot);
+		framesched_set_policy(&server_state->framesched, &server_state->screen_fps[snapshot.ui_screen]);
+		if (!have_frame || server_state->always_render || (snapshot.generation != rendered_generation)) {
+			have_frame = true;
+			rendered_generation = snapshot.generation;
+			server_state->frameno++;
+
+			struct swapchain_slot_t *slot = swapchain_acquire(server_state->swapchain);
+			slot->frameno = server_state->frameno;
+			slot->generation = snapshot.generation;
+			slot->historian_msgno = snapshot.historian_msgno;
+			if (slot->swbuf->profile != server_state->profilegov.profile) {
+				swbuf_set_profile(slot->swbuf, server_state->profilegov.profile);
+			}
+			uint64_t t0 = now_monotonic_ns();
+			swbuf_render_full_hd(&snapshot, slot->swbuf);
+			const uint64_t t1 = perfstat_record(STAGE_RENDER, t0);
+			profilegov_record(&server_state->profilegov, t1 - t0, server_state->framesched.fps);
+			swapchain_queue(server_state->swapchain, slot);
+			server_state->frame_stats.rendered++;
+		} else {
+			server_state->frame_stats.skipped++;
+		}
+		framesched_wait(&server_state->framesched);
+	}
+	swapchain_stop(server_state->swapchain);
+	return NULL;
+}
+
+static void* warm_up_thread_fnc(void *vwarm_up) {
+	struct warm_up_t *warm_up = (struct warm_up_t*)vwarm_up;
+	uint64_t t0 = now_monotonic_ns();
+	warm_up->success = renderer_full_hd_load_fonts(warm_up->private_fontconfig, warm_up->extra_fonts, warm_up->extra_font_count);
+	warm_up->fonts_loaded_ns = now_monotonic_ns() - t0;
+	if (!warm_up->success) {
+		return NULL;
+	}
+
+	t0 = now_monotonic_ns();
+	struct cairo_swbuf_t *swbuf = create_swbuf(warm_up->width, warm_up->height, warm_up->bits_per_pixel);
+	if (swbuf) {
+		renderer_full_hd_warm_up(&warm_up->state, swbuf);
+		free_swbuf(swbuf);
+	}
+	warm_up->warm_up_ns = now_monotonic_ns() - t0;
+	return NULL;
+}
+
+static bool parse_fps_option(struct server_state_t *server_state, const char *arg) {
+	const char *screen_names[UI_SCREEN_COUNT] = {
+		[MAIN_SCREEN] = "main",
+		[GAME_SCREEN] = "game",
+		[FINISH_SCREEN] = "finish",
+	};
+
+	const char *equals = strchr(arg, '=');
+	if (!equals) {
+		return false;
+	}
+	/* Either "idle:active" or a single, fixed frame rate */
+	unsigned int idle_fps, active_fps;
+	int fields = sscanf(equals + 1, "%u:%u", &idle_fps, &active_fps);
+	if (fields == 1) {
+		active_fps = idle_fps;
+	} else if (fields != 2) {
+		return false;
+	}
+	if ((idle_fps == 0) || (active_fps < idle_fps)) {
+		return false;
+	}
+	for (unsigned int i = 0; i < UI_SCREEN_COUNT; i++) {
+		if ((strlen(screen_names[i]) == equals - arg) && !strncmp(screen_names[i], arg, equals - arg)) {
+			server_state->screen_fps[i].idle_fps = idle_fps;
+			server_state->screen_fps[i].active_fps = active_fps;
+			return true;
+		}
+	}
+	return false;
+}
+
+static bool parse_resolution(const char *arg, unsigned int *width, unsigned int *height) {
+	if (sscanf(arg, "%ux%u", width, height) != 2) {
+		return false;
+	}
+	return (*width > 0) && (*height > 0);
+}
+
+static void usage(const char *progname) {
+	fprintf(stderr, "%s [-q depth] [-f screen=idle[:active]] [-a] [-R] [-T threads[:tiles]] [-P profile] [-F] [-p] [-e fontfile] [-S splash] [-H WxH [-D n] [-o prefix] [-r]] [-s socket] [-L logfile] [fbdev]\n", progname);
+	fprintf(stderr, "\n");
+	fprintf(stderr, "  -q depth    Number of frame buffers in the render/present swap chain,\n");
+	fprintf(stderr, "              between %d and %d. Defaults to %d.\n", SWAPCHAIN_MIN_DEPTH, SWAPCHAIN_MAX_DEPTH, DEFAULT_SWAPCHAIN_DEPTH);
+	fprintf(stderr, "  -f screen=idle[:active]\n");
+	fprintf(stderr, "              Frame rate policy for a screen (main, game or finish). The\n");
+	fprintf(stderr, "              screen is refreshed at the idle rate and ramps up to the\n");
+	fprintf(stderr, "              active rate for %d ms after every incoming event. A single\n", DEFAULT_ACTIVE_HOLD_MS);
+	fprintf(stderr, "              value gives a fixed rate. Can be given multiple times.\n");
+	fprintf(stderr, "              Defaults to main=%d:%d, game=%d, finish=%d:%d.\n", DEFAULT_IDLE_FPS, DEFAULT_ACTIVE_FPS, DEFAULT_GAME_FPS, DEFAULT_IDLE_FPS, DEFAULT_ACTIVE_FPS);
+	fprintf(stderr, "  -a          Render every frame, even if nothing has changed.\n");
+	fprintf(stderr, "  -R          Render in retained mode, i.e., record a display list and only\n");
+	fprintf(stderr, "              redraw operations that changed since the buffer was last used.\n");
+	fprintf(stderr, "  -T threads[:tiles]\n");
+	fprintf(stderr, "              Rasterize every frame in horizontal bands on the given number\n");
+	fprintf(stderr, "              of worker threads. Defaults to %d bands.\n", TILERENDER_DEFAULT_TILES);
+	fprintf(stderr, "  -P profile  Render profile to start with: quality, balanced or fast.\n");
+	fprintf(stderr, "              Defaults to quality. When rendering keeps taking more than\n");
+	fprintf(stderr, "              %d%% of the frame period, the next faster profile is used.\n", PROFILEGOV_BUDGET_PERCENT);
+	fprintf(stderr, "  -F          Keep the render profile fixed, never switch automatically.\n");
+	fprintf(stderr, "  -p          Use a private fontconfig configuration that only contains\n");
+	fprintf(stderr, "              the bundled fonts and those given by -e instead of every\n");
+	fprintf(stderr, "              font installed on the system. Speeds up startup.\n");
+	fprintf(stderr, "  -e fontfile Additional font file to load, e.g., Roboto with -p. Can be\n");
+	fprintf(stderr, "              given up to %d times.\n", MAX_EXTRA_FONTS);
+	fprintf(stderr, "  -S splash   Raw image in the native pixel format of the display that is\n");
+	fprintf(stderr, "              shown right after startup while fonts and static layers are\n");
+	fprintf(stderr, "              prepared in the background, e.g., a frame dumped with -r or\n");
+	fprintf(stderr, "              a copy of the framebuffer device.\n");
+	fprintf(stderr, "  -H WxH      Render into memory at the given resolution instead of onto\n");
+	fprintf(stderr, "              a real display (e.g., -H 1920x1080).\n");
+	fprintf(stderr, "  -D n        In headless mode, dump every n-th presented frame.\n");
+	fprintf(stderr, "  -o prefix   Filename prefix of dumped frames. Defaults to \"frame_\".\n");
+	fprintf(stderr, "  -r          Dump frames as raw pixel data instead of PNG.\n");
+	fprintf(stderr, "  -s socket   UNIX socket of the historian. Defaults to %s.\n", DEFAULT_HISTORIAN_SOCKET);
+	fprintf(stderr, "  -L logfile  For every committed frame, log the CLOCK_MONOTONIC timestamp\n");
+	fprintf(stderr, "              in ns, frame number, state generation and the number of the\n");
+	fprintf(stderr, "              last historian message it reflects and the number of\n");
+	fprintf(stderr, "              pixels transferred to the display.\n");
+	fprintf(stderr, "  fbdev       Framebuffer device to render on. If omitted, an SDL window\n");
+	fprintf(stderr, "              is opened instead.\n");
 }
 
 int main(int argc, char **argv) {
+	const uint64_t startup_ns = now_monotonic_ns();
 	struct server_state_t server_state = {
-		.ui_screen = MAIN_SCREEN,
-		.screen_shown_at_ts = now(),
-		.isleep = ISLEEP_INITIALIZER,
+		.state = {
+			.ui_screen = MAIN_SCREEN,
+			.screen_shown_at_ts = now(),
+			.historian_state = UNCONNECTED,
+		},
+		.published_seqlock = SEQLOCK_INITIALIZER,
 		.running = true,
 		.shared_data_mutex = PTHREAD_MUTEX_INITIALIZER,
+		.screen_fps = {
+			[MAIN_SCREEN] = { .idle_fps = DEFAULT_IDLE_FPS, .active_fps = DEFAULT_ACTIVE_FPS, .active_hold_ms = DEFAULT_ACTIVE_HOLD_MS },
+			[GAME_SCREEN] = { .idle_fps = DEFAULT_GAME_FPS, .active_fps = DEFAULT_GAME_FPS, .active_hold_ms = DEFAULT_ACTIVE_HOLD_MS },
+			[FINISH_SCREEN] = { .idle_fps = DEFAULT_IDLE_FPS, .active_fps = DEFAULT_ACTIVE_FPS, .active_hold_ms = DEFAULT_ACTIVE_HOLD_MS },
+		},
 	};
 
+	unsigned int swapchain_depth = DEFAULT_SWAPCHAIN_DEPTH;
+	bool headless = false;
+	struct display_headless_init_t headless_params = { 0 };
+	const char *historian_socket = DEFAULT_HISTORIAN_SOCKET;
+	const char *frame_log_filename = NULL;
+	unsigned int tiled_threads = 0, tiled_tiles = 0;
+	enum render_profile_t render_profile = RENDER_PROFILE_QUALITY;
+	bool automatic_profile = true;
+	bool private_fontconfig = false;
+	char *extra_fonts[MAX_EXTRA_FONTS];
+	unsigned int extra_font_count = 0;
+	const char *splash_filename = NULL;
+	int opt;
+	while ((opt = getopt(argc, argv, "q:f:aRT:P:Fpe:S:H:D:o:rs:L:")) != -1) {
+		switch (opt) {
+			case 'q':
+				swapchain_depth = atoi(optarg);
+				break;
+
+			case 'f':
+				if (!parse_fps_option(&server_state, optarg)) {
+					fprintf(stderr, "Invalid frame rate specification: %s\n", optarg);
+					usage(argv[0]);
+					exit(EXIT_FAILURE);
+				}
+				break;
+
+			case 'a':
+				server_state.always_render = true;
+				break;
+
+			case 'R':
+				renderer_full_hd_set_retained(true);
+				break;
+
+			case 'T':
+				if (!tilerender_parse_spec(optarg, &tiled_threads, &tiled_tiles)) {
+					fprintf(stderr, "Invalid tiled rendering specification: %s\n", optarg);
+					usage(argv[0]);
+					exit(EXIT_FAILURE);
+				}
+				break;
+
+			case 'P':
+				if (!render_profile_parse(optarg, &render_profile)) {
+					fprintf(stderr, "Invalid render profile: %s\n", optarg);
+					usage(argv[0]);
+					exit(EXIT_FAILURE);
+				}
+				break;
+
+			case 'F':
+				automatic_profile = false;
+				break;
+
+			case 'p':
+				private_fontconfig = true;
+				break;
+
+			case 'e':
+				if (extra_font_count == MAX_EXTRA_FONTS) {
+					fprintf(stderr, "Too many extra fonts, at most %d are supported.\n", MAX_EXTRA_FONTS);
+					exit(EXIT_FAILURE);
+				}
+				extra_fonts[extra_font_count++] = optarg;
+				break;
+
+			case 'S':
+				splash_filename = optarg;
+				break;
+
+			case 'H':
+				if (!parse_resolution(optarg, &headless_params.width, &headless_params.height)) {
+					fprintf(stderr, "Invalid resolution: %s\n", optarg);
+					usage(argv[0]);
+					exit(EXIT_FAILURE);
+				}
+				headless = true;
+				break;
+
+			case 'D':
+				headless_params.dump_every = atoi(optarg);
+				break;
+
+			case 'o':
+				headless_params.dump_prefix = optarg;
+				break;
+
+			case 'r':
+				headless_params.dump_raw = true;
+				break;
+
+			case 's':
+				historian_socket = optarg;
+				break;
+
+			case 'L':
+				frame_log_filename = optarg;
+				break;
+
+			default:
+				usage(argv[0]);
+				exit(EXIT_FAILURE);
+		}
+	}
+	if (argc - optind > 1) {
+		usage(argv[0]);
+		exit(EXIT_FAILURE);
+	}
+
+	profilegov_init(&server_state.profilegov, render_profile, automatic_profile);
+	render_profile_set_default(render_profile);
+
+	if (!renderer_full_hd_set_tiled(tiled_threads, tiled_tiles)) {
+		fprintf(stderr, "Could not start tiled rendering.\n");
+		exit(EXIT_FAILURE);
+	}
+
+	if (!framesched_init(&server_state.framesched, &server_state.screen_fps[server_state.state.ui_screen])) {
+		fprintf(stderr, "Could not create frame scheduler.\n");
+		exit(EXIT_FAILURE);
+	}
+
 	struct display_t *display = NULL;
-	if (argc == 2) {
-		const char *filename = argv[1];
+	if (headless) {
+		display = display_init(&display_headless_calltable, &headless_params);
+	} else if (optind < argc) {
+		const char *filename = argv[optind];
 		display = display_init(&display_fb_calltable, (void*)filename);
 	} else {
 		struct display_sdl_init_t init_params = {
@@ -251,35 +621,133 @@ int main(int argc, char **argv) {
 	}
 	register_signal_handler(event_callback, &server_state);
 
-	cairo_addfont("../external/beon/beon-webfont.ttf");
-	cairo_addfont("../external/instruction/Instruction.ttf");
-
 	if (!display) {
 		fprintf(stderr, "Could not create display.\n");
 		exit(EXIT_FAILURE);
 	}
 
+	/* With a splash image, fonts are loaded and all screens rendered once on
+	 * a background thread while the swap chain and historian connection are
+	 * set up; otherwise, the first frame pays for that. */
+	struct warm_up_t warm_up = {
+		.private_fontconfig = private_fontconfig,
+		.extra_fonts = extra_fonts,
+		.extra_font_count = extra_font_count,
+		.width = display->width,
+		.height = display->height,
+		.bits_per_pixel = swbuf_bits_per_pixel_for_display(display),
+		.state = server_state.state,
+	};
+	pthread_t warm_up_thread;
+	if (splash_filename) {
+		struct splash_t *splash = splash_open(splash_filename);
+		if (splash && splash_show(splash, display)) {
+			fprintf(stderr, "First pixel on display %.1f ms after startup (splash image)\n", (now_monotonic_ns() - startup_ns) / 1e6);
+		}
+		splash_close(splash);
+
+		if (pthread_create(&warm_up_thread, NULL, warm_up_thread_fnc, &warm_up)) {
+			perror("pthread_create");
+			exit(EXIT_FAILURE);
+		}
+	} else {
+		uint64_t t0 = now_monotonic_ns();
+		warm_up.success = renderer_full_hd_load_fonts(private_fontconfig, extra_fonts, extra_font_count);
+		warm_up.fonts_loaded_ns = now_monotonic_ns() - t0;
+	}
+
+	server_state.swapchain = swapchain_create(swapchain_depth, display->width, display->height, swbuf_bits_per_pixel_for_display(display));
+	if (!server_state.swapchain) {
+		fprintf(stderr, "Could not create swap chain.\n");
+		exit(EXIT_FAILURE);
+	}
+
+	if (frame_log_filename) {
+		server_state.frame_log = fopen(frame_log_filename, "w");
+		if (!server_state.frame_log) {
+			perror(frame_log_filename);
+			exit(EXIT_FAILURE);
+		}
+	}
+
+	server_state_publish(&server_state);
+
 	/* Start historian connection */
-	server_state.historian = historian_connect("../historian/unix_sock", event_callback, &server_state);
+	server_state.historian = historian_connect(historian_socket, event_callback, &server_state);
 	if (!server_state.historian) {
 		fprintf(stderr, "Could not create historian connection instance.\n");
 		exit(EXIT_FAILURE);
 	}
 
-	struct cairo_swbuf_t *swbuf = create_swbuf(display->width, display->height);
-	while (server_state.running) {
-		server_state.frameno++;
-		pthread_mutex_lock(&server_state.shared_data_mutex);
-		swbuf_render_full_hd(&server_state, swbuf);
-		pthread_mutex_unlock(&server_state.shared_data_mutex);
-		blit_swbuf_on_display(swbuf, display);
+	if (splash_filename) {
+		pthread_join(warm_up_thread, NULL);
+	}
+	if (!warm_up.success) {
+		fprintf(stderr, "Could not set up fonts.\n");
+		exit(EXIT_FAILURE);
+	}
+
+	/* Rasterization happens in its own thread while this one presents the
+	 * previous frame. Presenting stays on the main thread because that is
+	 * where the SDL renderer was created. */
+	pthread_t render_thread;
+	if (pthread_create(&render_thread, NULL, render_thread_fnc, &server_state)) {
+		perror("pthread_create");
+		exit(EXIT_FAILURE);
+	}
+
+	struct swapchain_slot_t *slot;
+	/* What is on the display differs from the next frame only where either
+	 * of them has content drawn on top of the same static layer */
+	struct damage_t last_damage;
+	unsigned int last_base_layer_serial = 0;
+	bool first_frame = true;
+	while ((slot = swapchain_dequeue(server_state.swapchain)) != NULL) {
+		struct cairo_swbuf_t *swbuf = slot->swbuf;
+		struct damage_t present_damage;
+		if (last_base_layer_serial && (swbuf->base_layer_serial == last_base_layer_serial)) {
+			present_damage = last_damage;
+			damage_add_all(&present_damage, &swbuf->damage);
+		} else {
+			damage_init(&present_damage, swbuf->width, swbuf->height);
+			damage_set_full(&present_damage);
+			server_state.present_stats.full_frames++;
+		}
+		last_damage = swbuf->damage;
+		last_base_layer_serial = swbuf->base_layer_serial;
+
+		const unsigned long damaged_pixels = damage_pixel_count(&present_damage);
+		server_state.present_stats.frames++;
+		server_state.present_stats.damaged_pixels += damaged_pixels;
+		server_state.present_stats.total_pixels += swbuf->width * swbuf->height;
+
+		uint64_t t0 = now_monotonic_ns();
+		blit_swbuf_rects_on_display(swbuf, display, &present_damage);
+		t0 = perfstat_record(STAGE_BLIT, t0);
 		display_commit(display);
-		isleep(&server_state.isleep, 50);
+		t0 = perfstat_record(STAGE_COMMIT, t0);
+		if (first_frame) {
+			first_frame = false;
+			fprintf(stderr, "First live frame presented %.1f ms after startup (%s fontconfig, %.1f ms loading fonts, %.1f ms warming up)\n", (t0 - startup_ns) / 1e6, private_fontconfig ? "private" : "system", warm_up.fonts_loaded_ns / 1e6, warm_up.warm_up_ns / 1e6);
+		}
+		if (server_state.frame_log) {
+			fprintf(server_state.frame_log, "%" PRIu64 " %u %u %u %lu\n", t0, slot->frameno, slot->generation, slot->historian_msgno, damaged_pixels);
+			fflush(server_state.frame_log);
+		}
+		swapchain_release(server_state.swapchain, slot);
 	}
+	pthread_join(render_thread, NULL);
+
+	dump_statistics(&server_state);
 	historian_free(server_state.historian);
-	free_swbuf(swbuf);
+	if (server_state.frame_log) {
+		fclose(server_state.frame_log);
+	}
+	swapchain_free(server_state.swapchain);
+	framesched_free(&server_state.framesched);
 	display_free(display);
 
+	renderer_full_hd_free();
 	cairo_cleanup();
 	return 0;
 }
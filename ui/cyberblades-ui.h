@@ -23,12 +23,25 @@
 #ifndef __CYBERBLADES_UI_H__
 #define __CYBERBLADES_UI_H__
 
+#include <stdio.h>
+#include <stdint.h>
 #include <stdbool.h>
 #include <pthread.h>
-#include "isleep.h"
+#include "framesched.h"
+#include "seqlock.h"
+#include "historian.h"
+#include "swapchain.h"
+#include "profilegov.h"
 
 #define MAX_TEXT_WIDTH					48
 #define MAX_HIGHSCORE_ENTRY_COUNT		10
+#define DEFAULT_SWAPCHAIN_DEPTH			3
+#define DEFAULT_IDLE_FPS				2
+#define DEFAULT_ACTIVE_FPS				20
+#define DEFAULT_GAME_FPS				60
+#define DEFAULT_ACTIVE_HOLD_MS			2000
+#define DEFAULT_HISTORIAN_SOCKET		"../historian/unix_sock"
+#define MAX_EXTRA_FONTS					8
 
 
 enum ui_screen_t {
@@ -36,6 +49,7 @@ enum ui_screen_t {
 	GAME_SCREEN = 1,
 	FINISH_SCREEN = 2,
 };
+#define UI_SCREEN_COUNT					3
 
 enum difficulty_level_t {
 	EASY = 0,
@@ -77,6 +91,7 @@ struct highscore_entry_t {
 };
 
 struct highscore_table_t {
+	unsigned int version;
 	unsigned int entry_count;
 	struct song_metadata_t song_key;
 	struct highscore_entry_t entries[MAX_HIGHSCORE_ENTRY_COUNT];
@@ -97,20 +112,71 @@ struct player_info_t {
 	struct player_stats_t alltime;
 };
 
-struct server_state_t {
+struct frame_stats_t {
+	unsigned int rendered;
+	unsigned int skipped;
+};
+
+struct present_stats_t {
+	unsigned int frames;
+	unsigned int full_frames;
+	unsigned long long damaged_pixels;
+	unsigned long long total_pixels;
+};
+
+struct lock_stats_t {
+	unsigned long long acquisitions;
+	unsigned long long contended;
+	uint64_t wait_ns;
+};
+
+/* Everything that the renderer needs to produce a frame. Writers modify the
+ * copy in server_state_t while holding the shared data mutex and then publish
+ * it; the renderer only ever works on a published snapshot. */
+struct render_state_t {
+	unsigned int generation;
 	enum ui_screen_t ui_screen;
 	double screen_shown_at_ts;
 
+	enum historian_state_t historian_state;
+	unsigned int historian_msgno;
 	bool connected_to_beatsaber;
 	struct player_info_t player;
 	struct song_info_t current_song;
 	struct highscore_table_t highscores;
+};
+
+struct server_state_t {
+	struct render_state_t state;
+	struct seqlock_t published_seqlock;
+	struct render_state_t published;
 
 	struct historian_t *historian;
-	struct isleep_t isleep;
+	struct swapchain_t *swapchain;
+	FILE *frame_log;
+	struct framesched_t framesched;
+	struct framesched_policy_t screen_fps[UI_SCREEN_COUNT];
+	struct profilegov_t profilegov;
 	bool running;
+	bool always_render;
 	pthread_mutex_t shared_data_mutex;
+	struct lock_stats_t lock_stats;
 	unsigned int frameno;
+	struct frame_stats_t frame_stats;
+	struct present_stats_t present_stats;
+};
+
+/* Work done on a background thread while a splash image is shown */
+struct warm_up_t {
+	bool private_fontconfig;
+	char **extra_fonts;
+	unsigned int extra_font_count;
+	unsigned int width, height;
+	unsigned int bits_per_pixel;
+	struct render_state_t state;
+	bool success;
+	uint64_t fonts_loaded_ns;
+	uint64_t warm_up_ns;
 };
 
 /*************** AUTO GENERATED SECTION FOLLOWS ***************/
@@ -0,0 +1,179 @@
+/*
+	pibeatsaber - Beat Saber historian application that tracks players
+	Copyright (C) 2019-2019 Johannes Bauer
+
+	This file is part of pibeatsaber.
+
+	pibeatsaber is free software; you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation; this program is ONLY licensed under
+	version 3 of the License, later versions are explicitly excluded.
+
+	pibeatsaber is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+	Johannes Bauer <JohannesBauer@gmx.de>
+*/
+
+#include <string.h>
+#include "damage.h"
+
+void damage_init(struct damage_t *damage, unsigned int bounds_width, unsigned int bounds_height) {
+	memset(damage, 0, sizeof(*damage));
+	damage->bounds_width = bounds_width;
+	damage->bounds_height = bounds_height;
+}
+
+void damage_reset(struct damage_t *damage) {
+	damage->full = false;
+	damage->count = 0;
+}
+
+void damage_set_full(struct damage_t *damage) {
+	damage->full = true;
+	damage->count = 1;
+	damage->rects[0] = (struct damage_rect_t) {
+		.width = damage->bounds_width,
+		.height = damage->bounds_height,
+	};
+}
+
+static unsigned long rect_area(const struct damage_rect_t *rect) {
+	return (unsigned long)rect->width * rect->height;
+}
+
+static struct damage_rect_t rect_union(const struct damage_rect_t *a, const struct damage_rect_t *b) {
+	int x1 = (a->x < b->x) ? a->x : b->x;
+	int y1 = (a->y < b->y) ? a->y : b->y;
+	int x2 = ((a->x + (int)a->width) > (b->x + (int)b->width)) ? (a->x + (int)a->width) : (b->x + (int)b->width);
+	int y2 = ((a->y + (int)a->height) > (b->y + (int)b->height)) ? (a->y + (int)a->height) : (b->y + (int)b->height);
+	return (struct damage_rect_t) {
+		.x = x1,
+		.y = y1,
+		.width = x2 - x1,
+		.height = y2 - y1,
+	};
+}
+
+static bool rect_intersects(const struct damage_rect_t *a, const struct damage_rect_t *b) {
+	return (a->x < b->x + (int)b->width) && (b->x < a->x + (int)a->width) && (a->y < b->y + (int)b->height) && (b->y < a->y + (int)a->height);
+}
+
+static void damage_remove(struct damage_t *damage, unsigned int index) {
+	damage->rects[index] = damage->rects[--damage->count];
+}
+
+static void damage_insert(struct damage_t *damage, struct damage_rect_t rect) {
+	/* Merge with everything that the rectangle touches; merging may make
+	 * the rectangle grow, so start over after every merge */
+	bool merged;
+	do {
+		merged = false;
+		for (unsigned int i = 0; i < damage->count; i++) {
+			if (rect_intersects(&rect, &damage->rects[i])) {
+				rect = rect_union(&rect, &damage->rects[i]);
+				damage_remove(damage, i);
+				merged = true;
+				break;
+			}
+		}
+	} while (merged);
+
+	if (damage->count < DAMAGE_MAX_RECTS) {
+		damage->rects[damage->count++] = rect;
+		return;
+	}
+
+	/* List is full, grow the rectangle that is affected the least */
+	unsigned int best_index = 0;
+	unsigned long best_growth = ~0UL;
+	for (unsigned int i = 0; i < damage->count; i++) {
+		struct damage_rect_t merged_rect = rect_union(&rect, &damage->rects[i]);
+		unsigned long growth = rect_area(&merged_rect) - rect_area(&damage->rects[i]);
+		if (growth < best_growth) {
+			best_growth = growth;
+			best_index = i;
+		}
+	}
+	rect = rect_union(&rect, &damage->rects[best_index]);
+	damage_remove(damage, best_index);
+	damage_insert(damage, rect);
+}
+
+void damage_add(struct damage_t *damage, int x, int y, int width, int height) {
+	if (damage->full) {
+		return;
+	}
+
+	/* Clip to the bounds */
+	if (x < 0) {
+		width += x;
+		x = 0;
+	}
+	if (y < 0) {
+		height += y;
+		y = 0;
+	}
+	if (x + width > (int)damage->bounds_width) {
+		width = (int)damage->bounds_width - x;
+	}
+	if (y + height > (int)damage->bounds_height) {
+		height = (int)damage->bounds_height - y;
+	}
+	if ((width <= 0) || (height <= 0)) {
+		return;
+	}
+
+	damage_insert(damage, (struct damage_rect_t) {
+		.x = x,
+		.y = y,
+		.width = width,
+		.height = height,
+	});
+}
+
+void damage_add_all(struct damage_t *damage, const struct damage_t *other) {
+	if (other->full) {
+		damage_set_full(damage);
+		return;
+	}
+	for (unsigned int i = 0; i < other->count; i++) {
+		const struct damage_rect_t *rect = &other->rects[i];
+		damage_add(damage, rect->x, rect->y, rect->width, rect->height);
+	}
+}
+
+bool damage_intersects(const struct damage_t *damage, const struct damage_rect_t *rect) {
+	for (unsigned int i = 0; i < damage->count; i++) {
+		if (rect_intersects(&damage->rects[i], rect)) {
+			return true;
+		}
+	}
+	return false;
+}
+
+/* Adds the part of another damage list that lies within the given rectangle */
+void damage_add_clipped(struct damage_t *damage, const struct damage_t *other, const struct damage_rect_t *clip) {
+	for (unsigned int i = 0; i < other->count; i++) {
+		const struct damage_rect_t *rect = &other->rects[i];
+		int x1 = (rect->x > clip->x) ? rect->x : clip->x;
+		int y1 = (rect->y > clip->y) ? rect->y : clip->y;
+		int x2 = ((rect->x + (int)rect->width) < (clip->x + (int)clip->width)) ? (rect->x + (int)rect->width) : (clip->x + (int)clip->width);
+		int y2 = ((rect->y + (int)rect->height) < (clip->y + (int)clip->height)) ? (rect->y + (int)rect->height) : (clip->y + (int)clip->height);
+		damage_add(damage, x1, y1, x2 - x1, y2 - y1);
+	}
+}
+
+/* Rectangles never overlap, so their areas can simply be summed up */
+unsigned long damage_pixel_count(const struct damage_t *damage) {
+	unsigned long pixels = 0;
+	for (unsigned int i = 0; i < damage->count; i++) {
+		pixels += rect_area(&damage->rects[i]);
+	}
+	return pixels;
+}
@@ -0,0 +1,56 @@
+/*
+	pibeatsaber - Beat Saber historian application that tracks players
+	Copyright (C) 2019-2019 Johannes Bauer
+
+	This file is part of pibeatsaber.
+
+	pibeatsaber is free software; you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation; this program is ONLY licensed under
+	version 3 of the License, later versions are explicitly excluded.
+
+	pibeatsaber is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+	Johannes Bauer <JohannesBauer@gmx.de>
+*/
+
+#ifndef __DAMAGE_H__
+#define __DAMAGE_H__
+
+#include <stdbool.h>
+
+#define DAMAGE_MAX_RECTS			32
+
+struct damage_rect_t {
+	int x, y;
+	unsigned int width, height;
+};
+
+/* List of rectangles that have changed within a buffer of the given size.
+ * Overlapping rectangles are merged; once the list is full, new rectangles
+ * are merged into whichever existing rectangle grows the least. */
+struct damage_t {
+	unsigned int bounds_width, bounds_height;
+	bool full;
+	unsigned int count;
+	struct damage_rect_t rects[DAMAGE_MAX_RECTS];
+};
+
+/*************** AUTO GENERATED SECTION FOLLOWS ***************/
+void damage_init(struct damage_t *damage, unsigned int bounds_width, unsigned int bounds_height);
+void damage_reset(struct damage_t *damage);
+void damage_set_full(struct damage_t *damage);
+void damage_add(struct damage_t *damage, int x, int y, int width, int height);
+void damage_add_all(struct damage_t *damage, const struct damage_t *other);
+bool damage_intersects(const struct damage_t *damage, const struct damage_rect_t *rect);
+void damage_add_clipped(struct damage_t *damage, const struct damage_t *other, const struct damage_rect_t *clip);
+unsigned long damage_pixel_count(const struct damage_t *damage);
+/***************  AUTO GENERATED SECTION ENDS   ***************/
+
+#endif
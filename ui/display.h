@@ -28,6 +28,7 @@
 #include <pthread.h>
 #include "colors.h"
 #include "ui_events.h"
+#include "damage.h"
 
 struct display_t;
 struct display_calltable_t;
@@ -55,6 +56,7 @@ struct display_calltable_t {
 	void (*put_pixel)(struct display_t *display, unsigned int x, unsigned int y, uint32_t color);
 	void (*commit)(struct display_t *display);
 	bool (*blit_buffer)(struct display_t *display, uint32_t *source, unsigned int width, unsigned int height);
+	bool (*blit_rects)(struct display_t *display, uint32_t *source, unsigned int width, unsigned int height, const struct damage_t *damage);
 	unsigned int (*get_ctx_size)(void);
 };
 
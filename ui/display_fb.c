@@ -158,8 +158,10 @@ static unsigned int display_fb_get_ctx_size(void) {
 	return sizeof(struct display_fb_ctx_t);
 }
 
+/* The source buffer is in the native pixel format of the display, i.e., either
+ * 32 bpp or RGB565 */
 static bool display_fb_blit_buffer(struct display_t *display, uint32_t *source, unsigned int width, unsigned int height) {
-	if (display->bits_per_pixel != 32) {
+	if ((display->bits_per_pixel != 32) && (display->bits_per_pixel != 16)) {
 		return false;
 	}
 	if ((width != display->width) || (height != display->height)) {
@@ -167,7 +169,28 @@ static bool display_fb_blit_buffer(struct display_t *display, uint32_t *source,
 	}
 
 	struct display_fb_ctx_t *ctx = (struct display_fb_ctx_t*)display->drv_context;
-	memcpy(ctx->screen, source, sizeof(uint32_t) * width * height);
+	memcpy(ctx->screen, source, display_get_mapped_size(display));
+	return true;
+}
+
+static bool display_fb_blit_rects(struct display_t *display, uint32_t *source, unsigned int width, unsigned int height, const struct damage_t *damage) {
+	if ((display->bits_per_pixel != 32) && (display->bits_per_pixel != 16)) {
+		return false;
+	}
+	if ((width != display->width) || (height != display->height)) {
+		return false;
+	}
+
+	struct display_fb_ctx_t *ctx = (struct display_fb_ctx_t*)display->drv_context;
+	const unsigned int bytes_per_pixel = display->bits_per_pixel / 8;
+	const unsigned int stride = width * bytes_per_pixel;
+	for (unsigned int i = 0; i < damage->count; i++) {
+		const struct damage_rect_t *rect = &damage->rects[i];
+		for (unsigned int y = rect->y; y < rect->y + rect->height; y++) {
+			const unsigned int offset = (y * stride) + (rect->x * bytes_per_pixel);
+			memcpy(ctx->screen + offset, (const uint8_t*)source + offset, rect->width * bytes_per_pixel);
+		}
+	}
 	return true;
 }
 
@@ -178,4 +201,5 @@ const struct display_calltable_t display_fb_calltable = {
 	.put_pixel = display_fb_put_pixel,
 	.get_ctx_size = display_fb_get_ctx_size,
 	.blit_buffer = display_fb_blit_buffer,
+	.blit_rects = display_fb_blit_rects,
 };
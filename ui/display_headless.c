@@ -0,0 +1,147 @@
+/*
+	pibeatsaber - Beat Saber historian application that tracks players
+	Copyright (C) 2019-2019 Johannes Bauer
+
+	This file is part of pibeatsaber.
+
+	pibeatsaber is free software; you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation; this program is ONLY licensed under
+	version 3 of the License, later versions are explicitly excluded.
+
+	pibeatsaber is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+	Johannes Bauer <JohannesBauer@gmx.de>
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <cairo/cairo.h>
+#include "display_headless.h"
+
+static unsigned int display_headless_get_size(const struct display_t *display) {
+	return display->width * display->height * display->bits_per_pixel / 8;
+}
+
+static void display_headless_put_pixel(struct display_t *display, unsigned int x, unsigned int y, uint32_t rgb) {
+	struct display_headless_ctx_t *ctx = (struct display_headless_ctx_t*)display->drv_context;
+	uint32_t *screen = (uint32_t*)ctx->screen;
+	screen[(y * display->width) + x] = rgb;
+}
+
+static void display_headless_fill(struct display_t *display, uint32_t rgb) {
+	struct display_headless_ctx_t *ctx = (struct display_headless_ctx_t*)display->drv_context;
+	uint32_t *screen = (uint32_t*)ctx->screen;
+	for (unsigned int i = 0; i < display->width * display->height; i++) {
+		screen[i] = rgb;
+	}
+}
+
+static void display_headless_dump_raw(struct display_t *display, const char *filename) {
+	struct display_headless_ctx_t *ctx = (struct display_headless_ctx_t*)display->drv_context;
+	FILE *f = fopen(filename, "wb");
+	if (!f) {
+		perror(filename);
+		return;
+	}
+	if (fwrite(ctx->screen, display_headless_get_size(display), 1, f) != 1) {
+		perror("fwrite");
+	}
+	fclose(f);
+}
+
+static void display_headless_dump_png(struct display_t *display, const char *filename) {
+	struct display_headless_ctx_t *ctx = (struct display_headless_ctx_t*)display->drv_context;
+	cairo_surface_t *surface = cairo_image_surface_create_for_data(ctx->screen, CAIRO_FORMAT_RGB24, display->width, display->height, display->width * 4);
+	if (cairo_surface_write_to_png(surface, filename) != CAIRO_STATUS_SUCCESS) {
+		fprintf(stderr, "Could not write %s\n", filename);
+	}
+	cairo_surface_destroy(surface);
+}
+
+static void display_headless_commit(struct display_t *display) {
+	struct display_headless_ctx_t *ctx = (struct display_headless_ctx_t*)display->drv_context;
+	if (ctx->dump_every && ((ctx->frame_count % ctx->dump_every) == 0)) {
+		char filename[256];
+		snprintf(filename, sizeof(filename), "%s%06u.%s", ctx->dump_prefix, ctx->frame_count, ctx->dump_raw ? "raw" : "png");
+		if (ctx->dump_raw) {
+			display_headless_dump_raw(display, filename);
+		} else {
+			display_headless_dump_png(display, filename);
+		}
+	}
+	ctx->frame_count++;
+}
+
+static bool display_headless_init(struct display_t *display, void *init_ctx) {
+	struct display_headless_ctx_t *ctx = (struct display_headless_ctx_t*)display->drv_context;
+	struct display_headless_init_t *initctx = (struct display_headless_init_t*)init_ctx;
+	display->width = initctx->width;
+	display->height = initctx->height;
+	display->bits_per_pixel = 32;
+	ctx->dump_every = initctx->dump_every;
+	ctx->dump_prefix = initctx->dump_prefix ? initctx->dump_prefix : "frame_";
+	ctx->dump_raw = initctx->dump_raw;
+
+	ctx->screen = calloc(display_headless_get_size(display), 1);
+	if (!ctx->screen) {
+		perror("calloc");
+		return false;
+	}
+	fprintf(stderr, "Initiated headless display %d x %d pixels at %d BPP\n", display->width, display->height, display->bits_per_pixel);
+	return true;
+}
+
+static void display_headless_free(struct display_t *display) {
+	struct display_headless_ctx_t *ctx = (struct display_headless_ctx_t*)display->drv_context;
+	free(ctx->screen);
+}
+
+static unsigned int display_headless_get_ctx_size(void) {
+	return sizeof(struct display_headless_ctx_t);
+}
+
+static bool display_headless_blit_buffer(struct display_t *display, uint32_t *source, unsigned int width, unsigned int height) {
+	if ((width != display->width) || (height != display->height)) {
+		return false;
+	}
+
+	struct display_headless_ctx_t *ctx = (struct display_headless_ctx_t*)display->drv_context;
+	memcpy(ctx->screen, source, sizeof(uint32_t) * width * height);
+	return true;
+}
+
+static bool display_headless_blit_rects(struct display_t *display, uint32_t *source, unsigned int width, unsigned int height, const struct damage_t *damage) {
+	if ((width != display->width) || (height != display->height)) {
+		return false;
+	}
+
+	struct display_headless_ctx_t *ctx = (struct display_headless_ctx_t*)display->drv_context;
+	uint32_t *screen = (uint32_t*)ctx->screen;
+	for (unsigned int i = 0; i < damage->count; i++) {
+		const struct damage_rect_t *rect = &damage->rects[i];
+		for (unsigned int y = rect->y; y < rect->y + rect->height; y++) {
+			memcpy(screen + (y * width) + rect->x, source + (y * width) + rect->x, sizeof(uint32_t) * rect->width);
+		}
+	}
+	return true;
+}
+
+const struct display_calltable_t display_headless_calltable = {
+	.init = display_headless_init,
+	.free = display_headless_free,
+	.fill = display_headless_fill,
+	.commit = display_headless_commit,
+	.put_pixel = display_headless_put_pixel,
+	.get_ctx_size = display_headless_get_ctx_size,
+	.blit_buffer = display_headless_blit_buffer,
+	.blit_rects = display_headless_blit_rects,
+};
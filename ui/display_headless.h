@@ -0,0 +1,50 @@
+/*
+	pibeatsaber - Beat Saber historian application that tracks players
+	Copyright (C) 2019-2019 Johannes Bauer
+
+	This file is part of pibeatsaber.
+
+	pibeatsaber is free software; you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation; this program is ONLY licensed under
+	version 3 of the License, later versions are explicitly excluded.
+
+	pibeatsaber is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+	Johannes Bauer <JohannesBauer@gmx.de>
+*/
+
+#ifndef __DISPLAY_HEADLESS_H__
+#define __DISPLAY_HEADLESS_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "display.h"
+
+struct display_headless_init_t {
+	unsigned int width, height;
+	unsigned int dump_every;
+	const char *dump_prefix;
+	bool dump_raw;
+};
+
+struct display_headless_ctx_t {
+	uint8_t *screen;
+	unsigned int frame_count;
+	unsigned int dump_every;
+	const char *dump_prefix;
+	bool dump_raw;
+};
+
+extern const struct display_calltable_t display_headless_calltable;
+
+/*************** AUTO GENERATED SECTION FOLLOWS ***************/
+/***************  AUTO GENERATED SECTION ENDS   ***************/
+
+#endif
@@ -150,6 +150,9 @@ static bool display_sdl_init(struct display_t *display, void *init_ctx) {
 
 static void display_sdl_free(struct display_t *display) {
 	struct display_sdl_ctx_t *ctx = (struct display_sdl_ctx_t*)display->drv_context;
+	if (ctx->texture) {
+		SDL_DestroyTexture(ctx->texture);
+	}
 	SDL_DestroyWindow(ctx->window);
 	SDL_Quit();
 }
@@ -165,21 +168,65 @@ void display_sdl_register_events(struct display_t *display, ui_event_cb_t event_
 	pthread_create(&display->hmi_events.event_thread, NULL, display_sdl_eventthread_fnc, display);
 }
 
+/* The streaming texture persists across frames, so only the damaged
+ * rectangles need to be uploaded. The renderer's back buffer contents are
+ * undefined after presenting, therefore the whole texture is copied every
+ * time, which happens on the GPU. */
+static SDL_Texture *display_sdl_get_texture(struct display_sdl_ctx_t *ctx, unsigned int width, unsigned int height) {
+	if (ctx->texture && ((ctx->texture_width != width) || (ctx->texture_height != height))) {
+		SDL_DestroyTexture(ctx->texture);
+		ctx->texture = NULL;
+	}
+	if (!ctx->texture) {
+		ctx->texture = SDL_CreateTexture(ctx->renderer, SDL_PIXELFORMAT_ARGB8888, SDL_TEXTUREACCESS_STREAMING, width, height);
+		if (!ctx->texture) {
+			fprintf(stderr, "Could not create SDL texture: %s\n", SDL_GetError());
+			return NULL;
+		}
+		ctx->texture_width = width;
+		ctx->texture_height = height;
+	}
+	return ctx->texture;
+}
+
 /* When we use an accelerated renderer, we simply cannot directly access the
  * target surface anymore (it's implicit), therefore, blit_buffer *must* work
  */
 static bool display_sdl_blit_buffer(struct display_t *display, uint32_t *source, unsigned int width, unsigned int height) {
 	struct display_sdl_ctx_t *ctx = (struct display_sdl_ctx_t*)display->drv_context;
-	SDL_Surface *surface = SDL_CreateRGBSurfaceFrom(source, width, height, 32, 4 * width, COLOR_RMASK, COLOR_GMASK, COLOR_BMASK, 0);
-	SDL_Texture *texture = SDL_CreateTextureFromSurface(ctx->renderer, surface);
-	if (surface) {
-		SDL_RenderCopy(ctx->renderer, texture, NULL, NULL);
-		SDL_DestroyTexture(texture);
-		SDL_FreeSurface(surface);
-		return true;
-	} else {
+	SDL_Texture *texture = display_sdl_get_texture(ctx, width, height);
+	if (!texture) {
 		return false;
 	}
+	SDL_UpdateTexture(texture, NULL, source, 4 * width);
+	SDL_RenderCopy(ctx->renderer, texture, NULL, NULL);
+	return true;
+}
+
+static bool display_sdl_blit_rects(struct display_t *display, uint32_t *source, unsigned int width, unsigned int height, const struct damage_t *damage) {
+	struct display_sdl_ctx_t *ctx = (struct display_sdl_ctx_t*)display->drv_context;
+	bool new_texture = !ctx->texture || (ctx->texture_width != width) || (ctx->texture_height != height);
+	SDL_Texture *texture = display_sdl_get_texture(ctx, width, height);
+	if (!texture) {
+		return false;
+	}
+	if (new_texture) {
+		/* Texture contents are undefined, upload everything */
+		SDL_UpdateTexture(texture, NULL, source, 4 * width);
+	} else {
+		for (unsigned int i = 0; i < damage->count; i++) {
+			const struct damage_rect_t *rect = &damage->rects[i];
+			const SDL_Rect sdl_rect = {
+				.x = rect->x,
+				.y = rect->y,
+				.w = rect->width,
+				.h = rect->height,
+			};
+			SDL_UpdateTexture(texture, &sdl_rect, source + (rect->y * width) + rect->x, 4 * width);
+		}
+	}
+	SDL_RenderCopy(ctx->renderer, texture, NULL, NULL);
+	return true;
 }
 
 const struct display_calltable_t display_sdl_calltable = {
@@ -190,4 +237,5 @@ const struct display_calltable_t display_sdl_calltable = {
 	.put_pixel = display_sdl_put_pixel,
 	.get_ctx_size = display_sdl_get_ctx_size,
 	.blit_buffer = display_sdl_blit_buffer,
+	.blit_rects = display_sdl_blit_rects,
 };
@@ -31,6 +31,8 @@ struct display_sdl_ctx_t {
 	SDL_Window *window;
 	SDL_Surface *surface;
 	SDL_Renderer *renderer;
+	SDL_Texture *texture;
+	unsigned int texture_width, texture_height;
 };
 
 struct display_sdl_init_t {
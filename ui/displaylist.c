@@ -0,0 +1,203 @@
+/*
+	pibeatsaber - Beat Saber historian application that tracks players
+	Copyright (C) 2019-2019 Johannes Bauer
+
+	This file is part of pibeatsaber.
+
+	pibeatsaber is free software; you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation; this program is ONLY licensed under
+	version 3 of the License, later versions are explicitly excluded.
+
+	pibeatsaber is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+	Johannes Bauer <JohannesBauer@gmx.de>
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "displaylist.h"
+
+struct displaylist_t *displaylist_create(void) {
+	struct displaylist_t *displaylist = calloc(sizeof(struct displaylist_t), 1);
+	if (!displaylist) {
+		perror("calloc");
+		return NULL;
+	}
+	return displaylist;
+}
+
+static struct displaylist_ops_t *displaylist_current(const struct displaylist_t *displaylist) {
+	return (struct displaylist_ops_t*)&displaylist->frames[displaylist->current];
+}
+
+static struct displaylist_ops_t *displaylist_previous(const struct displaylist_t *displaylist) {
+	return (struct displaylist_ops_t*)&displaylist->frames[displaylist->current ^ 1];
+}
+
+/* The list recorded last becomes the previous one and recording starts over */
+void displaylist_begin(struct displaylist_t *displaylist) {
+	displaylist->current ^= 1;
+	displaylist->previous_valid = displaylist->current_valid;
+	displaylist->current_valid = false;
+	displaylist_current(displaylist)->count = 0;
+	displaylist->recording = true;
+}
+
+void displaylist_end(struct displaylist_t *displaylist) {
+	displaylist->recording = false;
+	displaylist->current_valid = true;
+}
+
+/* Called when the buffer contents were produced without the display list,
+ * so the recorded operations do not describe them anymore */
+void displaylist_invalidate(struct displaylist_t *displaylist) {
+	displaylist->current_valid = false;
+}
+
+static uint32_t displaylist_hash_text(const char *text) {
+	uint32_t hash = 0x811c9dc5;
+	while (*text) {
+		hash = (hash ^ (uint8_t)*text++) * 0x01000193;
+	}
+	return hash;
+}
+
+void displaylist_record(struct displaylist_t *displaylist, const struct displaylist_op_t *op) {
+	struct displaylist_ops_t *ops = displaylist_current(displaylist);
+	if (ops->count == ops->alloced) {
+		unsigned int new_alloced = ops->alloced ? (2 * ops->alloced) : 64;
+		struct displaylist_op_t *new_ops = realloc(ops->ops, sizeof(struct displaylist_op_t) * new_alloced);
+		if (!new_ops) {
+			perror("realloc");
+			return;
+		}
+		ops->ops = new_ops;
+		ops->alloced = new_alloced;
+	}
+	struct displaylist_op_t *new_op = &ops->ops[ops->count++];
+	*new_op = *op;
+	new_op->hash = (op->type == DL_OP_TEXT) ? displaylist_hash_text(op->text.text) : 0;
+}
+
+static bool displaylist_op_equal(const struct displaylist_op_t *a, const struct displaylist_op_t *b) {
+	if ((a->type != b->type) || (a->hash != b->hash) || memcmp(&a->bbox, &b->bbox, sizeof(a->bbox))) {
+		return false;
+	}
+	switch (a->type) {
+		case DL_OP_TEXT:
+			return (a->text.font == b->text.font) && (a->text.color == b->text.color) && (a->text.cache_sprite == b->text.cache_sprite) && (a->text.tabular == b->text.tabular)
+				&& (a->text.x == b->text.x) && (a->text.baseline_y == b->text.baseline_y) && !strcmp(a->text.text, b->text.text);
+
+		case DL_OP_RECT:
+			return (a->rect.x == b->rect.x) && (a->rect.y == b->rect.y) && (a->rect.width == b->rect.width) && (a->rect.height == b->rect.height)
+				&& (a->rect.round == b->rect.round) && (a->rect.color == b->rect.color) && (a->rect.fill == b->rect.fill);
+
+		case DL_OP_CIRCLE:
+			return (a->circle.x == b->circle.x) && (a->circle.y == b->circle.y) && (a->circle.radius == b->circle.radius) && (a->circle.color == b->circle.color);
+
+		case DL_OP_SURFACE:
+			return (a->surface.source == b->surface.source) && (a->surface.serial == b->surface.serial) && (a->surface.x == b->surface.x) && (a->surface.y == b->surface.y);
+	}
+	return false;
+}
+
+static bool displaylist_ops_contain(const struct displaylist_ops_t *ops, const struct displaylist_op_t *op, unsigned int hint_index) {
+	/* Most lists are recorded in the same order every frame */
+	if ((hint_index < ops->count) && displaylist_op_equal(&ops->ops[hint_index], op)) {
+		return true;
+	}
+	for (unsigned int i = 0; i < ops->count; i++) {
+		if (displaylist_op_equal(&ops->ops[i], op)) {
+			return true;
+		}
+	}
+	return false;
+}
+
+/* Adds the bounding boxes of all operations that were either added or
+ * removed since the previous frame to the damage list. Returns the number of
+ * changed operations. */
+unsigned int displaylist_diff(const struct displaylist_t *displaylist, struct damage_t *damage) {
+	const struct displaylist_ops_t *current = displaylist_current(displaylist);
+	const struct displaylist_ops_t *previous = displaylist_previous(displaylist);
+	unsigned int changed = 0;
+	for (unsigned int i = 0; i < current->count; i++) {
+		if (!displaylist_ops_contain(previous, &current->ops[i], i)) {
+			damage_add(damage, current->ops[i].bbox.x, current->ops[i].bbox.y, current->ops[i].bbox.width, current->ops[i].bbox.height);
+			changed++;
+		}
+	}
+	for (unsigned int i = 0; i < previous->count; i++) {
+		if (!displaylist_ops_contain(current, &previous->ops[i], i)) {
+			damage_add(damage, previous->ops[i].bbox.x, previous->ops[i].bbox.y, previous->ops[i].bbox.width, previous->ops[i].bbox.height);
+			changed++;
+		}
+	}
+	return changed;
+}
+
+/* Area covered by all operations of the current frame */
+void displaylist_get_coverage(const struct displaylist_t *displaylist, struct damage_t *damage) {
+	const struct displaylist_ops_t *current = displaylist_current(displaylist);
+	for (unsigned int i = 0; i < current->count; i++) {
+		damage_add(damage, current->ops[i].bbox.x, current->ops[i].bbox.y, current->ops[i].bbox.width, current->ops[i].bbox.height);
+	}
+}
+
+static bool displaylist_op_intersects(const struct displaylist_op_t *op, const struct damage_t *clip) {
+	if (clip->full) {
+		return true;
+	}
+	for (unsigned int i = 0; i < clip->count; i++) {
+		const struct damage_rect_t *rect = &clip->rects[i];
+		if ((op->bbox.x < rect->x + (int)rect->width) && (rect->x < op->bbox.x + (int)op->bbox.width) && (op->bbox.y < rect->y + (int)rect->height) && (rect->y < op->bbox.y + (int)op->bbox.height)) {
+			return true;
+		}
+	}
+	return false;
+}
+
+/* Draws all operations of the current frame that touch the clip region,
+ * clipped to it. Returns the number of operations drawn. */
+unsigned int displaylist_replay(const struct displaylist_t *displaylist, struct cairo_swbuf_t *swbuf, const struct damage_t *clip) {
+	const struct displaylist_ops_t *current = displaylist_current(displaylist);
+	if (!clip->count) {
+		return 0;
+	}
+
+	cairo_save(swbuf->ctx);
+	cairo_new_path(swbuf->ctx);
+	for (unsigned int i = 0; i < clip->count; i++) {
+		cairo_rectangle(swbuf->ctx, clip->rects[i].x, clip->rects[i].y, clip->rects[i].width, clip->rects[i].height);
+	}
+	cairo_clip(swbuf->ctx);
+	swbuf->clip = clip;
+
+	unsigned int replayed = 0;
+	for (unsigned int i = 0; i < current->count; i++) {
+		if (displaylist_op_intersects(&current->ops[i], clip)) {
+			swbuf_draw_op(swbuf, &current->ops[i]);
+			replayed++;
+		}
+	}
+	swbuf->clip = NULL;
+	cairo_restore(swbuf->ctx);
+	return replayed;
+}
+
+void displaylist_free(struct displaylist_t *displaylist) {
+	if (!displaylist) {
+		return;
+	}
+	free(displaylist->frames[0].ops);
+	free(displaylist->frames[1].ops);
+	free(displaylist);
+}
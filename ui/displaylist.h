@@ -0,0 +1,119 @@
+/*
+	pibeatsaber - Beat Saber historian application that tracks players
+	Copyright (C) 2019-2019 Johannes Bauer
+
+	This file is part of pibeatsaber.
+
+	pibeatsaber is free software; you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation; this program is ONLY licensed under
+	version 3 of the License, later versions are explicitly excluded.
+
+	pibeatsaber is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+	Johannes Bauer <JohannesBauer@gmx.de>
+*/
+
+#ifndef __DISPLAYLIST_H__
+#define __DISPLAYLIST_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "cairo.h"
+#include "damage.h"
+#include "fontcache.h"
+
+#define DISPLAYLIST_MAX_TEXT_LENGTH		511
+
+enum displaylist_op_type_t {
+	DL_OP_TEXT,
+	DL_OP_RECT,
+	DL_OP_CIRCLE,
+	DL_OP_SURFACE,
+};
+
+/* Text is positioned by the left edge of its ink and its baseline. Tabular
+ * text only consists of numeric characters and is drawn from the font's
+ * precomputed glyphs. */
+struct displaylist_text_op_t {
+	const struct fontcache_entry_t *font;
+	uint32_t color;
+	bool cache_sprite;
+	bool tabular;
+	int x, baseline_y;
+	cairo_text_extents_t extents;
+	char text[DISPLAYLIST_MAX_TEXT_LENGTH + 1];
+};
+
+struct displaylist_rect_op_t {
+	int x, y;
+	unsigned int width, height;
+	unsigned int round;
+	uint32_t color;
+	bool fill;
+};
+
+struct displaylist_circle_op_t {
+	int x, y;
+	unsigned int radius;
+	uint32_t color;
+};
+
+/* Composites the covered parts of a surface that is owned by a cache. The
+ * serial changes whenever the surface's contents change. */
+struct displaylist_surface_op_t {
+	cairo_surface_t *source;
+	unsigned int serial;
+	int x, y;
+	const struct damage_t *coverage;
+};
+
+/* A drawing operation with its placement fully resolved */
+struct displaylist_op_t {
+	enum displaylist_op_type_t type;
+	uint32_t hash;
+	struct damage_rect_t bbox;
+	union {
+		struct displaylist_text_op_t text;
+		struct displaylist_rect_op_t rect;
+		struct displaylist_circle_op_t circle;
+		struct displaylist_surface_op_t surface;
+	};
+};
+
+struct displaylist_ops_t {
+	unsigned int count;
+	unsigned int alloced;
+	struct displaylist_op_t *ops;
+};
+
+/* Retained display list of a software buffer. It holds the operations that
+ * were drawn into the buffer the last time as well as the ones recorded for
+ * the frame currently being rendered. */
+struct displaylist_t {
+	bool recording;
+	bool previous_valid;
+	bool current_valid;
+	unsigned int current;
+	struct displaylist_ops_t frames[2];
+};
+
+/*************** AUTO GENERATED SECTION FOLLOWS ***************/
+struct displaylist_t *displaylist_create(void);
+void displaylist_begin(struct displaylist_t *displaylist);
+void displaylist_end(struct displaylist_t *displaylist);
+void displaylist_invalidate(struct displaylist_t *displaylist);
+void displaylist_record(struct displaylist_t *displaylist, const struct displaylist_op_t *op);
+unsigned int displaylist_diff(const struct displaylist_t *displaylist, struct damage_t *damage);
+void displaylist_get_coverage(const struct displaylist_t *displaylist, struct damage_t *damage);
+unsigned int displaylist_replay(const struct displaylist_t *displaylist, struct cairo_swbuf_t *swbuf, const struct damage_t *clip);
+void displaylist_free(struct displaylist_t *displaylist);
+/***************  AUTO GENERATED SECTION ENDS   ***************/
+
+#endif
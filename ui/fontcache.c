@@ -0,0 +1,183 @@
+/*
+	pibeatsaber - Beat Saber historian application that tracks players
+	Copyright (C) 2019-2019 Johannes Bauer
+
+	This file is part of pibeatsaber.
+
+	pibeatsaber is free software; you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation; this program is ONLY licensed under
+	version 3 of the License, later versions are explicitly excluded.
+
+	pibeatsaber is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+	Johannes Bauer <JohannesBauer@gmx.de>
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <pthread.h>
+#include "fontcache.h"
+
+/* Resolving a font face by its family name goes through fontconfig matching,
+ * which is far too expensive to do for every text element of every frame.
+ * Scaled fonts are therefore resolved once per (face, size, bold) and kept
+ * until the cache is flushed. Entries are never evicted, so pointers handed
+ * out by fontcache_get() stay valid until fontcache_flush(). */
+static pthread_mutex_t fontcache_mutex = PTHREAD_MUTEX_INITIALIZER;
+static struct fontcache_entry_t **fontcache_entries;
+static unsigned int fontcache_entry_count;
+static unsigned int fontcache_entry_alloced;
+static struct fontcache_stats_t fontcache_stats;
+
+static struct fontcache_entry_t *fontcache_lookup(const char *font_face, unsigned int font_size, bool font_bold, const cairo_font_options_t *options) {
+	for (unsigned int i = 0; i < fontcache_entry_count; i++) {
+		struct fontcache_entry_t *entry = fontcache_entries[i];
+		if ((entry->font_size == font_size) && (entry->font_bold == font_bold) && (entry->options == options) && !strcmp(entry->font_face, font_face)) {
+			return entry;
+		}
+	}
+	return NULL;
+}
+
+/* Index into the numeric glyph tables or -1 if the character is not part of
+ * the numeric set */
+int fontcache_numeric_char_index(char c) {
+	const char *pos = strchr(FONTCACHE_NUMERIC_CHARS, c);
+	return (c && pos) ? (pos - FONTCACHE_NUMERIC_CHARS) : -1;
+}
+
+static void fontcache_resolve_numeric(struct fontcache_entry_t *entry) {
+	struct fontcache_numeric_t *numeric = &entry->numeric;
+	cairo_glyph_t *glyphs = NULL;
+	int glyph_count = 0;
+	if ((cairo_scaled_font_text_to_glyphs(entry->scaled_font, 0, 0, FONTCACHE_NUMERIC_CHARS, -1, &glyphs, &glyph_count, NULL, NULL, NULL) != CAIRO_STATUS_SUCCESS) || (glyph_count != FONTCACHE_NUMERIC_CHAR_COUNT)) {
+		/* Font does not map every character to exactly one glyph */
+		cairo_glyph_free(glyphs);
+		return;
+	}
+
+	double ink_top = 0, ink_bottom = 0, overhang = 0;
+	for (unsigned int i = 0; i < FONTCACHE_NUMERIC_CHAR_COUNT; i++) {
+		cairo_glyph_t glyph = {
+			.index = glyphs[i].index,
+		};
+		cairo_text_extents_t extents;
+		cairo_scaled_font_glyph_extents(entry->scaled_font, &glyph, 1, &extents);
+		numeric->glyph_index[i] = glyph.index;
+		numeric->advance[i] = extents.x_advance;
+		if ((i < 10) && (extents.x_advance > numeric->digit_advance)) {
+			numeric->digit_advance = extents.x_advance;
+		}
+		if (extents.y_bearing < ink_top) {
+			ink_top = extents.y_bearing;
+		}
+		if (extents.y_bearing + extents.height > ink_bottom) {
+			ink_bottom = extents.y_bearing + extents.height;
+		}
+		if (-extents.x_bearing > overhang) {
+			overhang = -extents.x_bearing;
+		}
+		if (extents.x_bearing + extents.width - extents.x_advance > overhang) {
+			overhang = extents.x_bearing + extents.width - extents.x_advance;
+		}
+	}
+	cairo_glyph_free(glyphs);
+
+	numeric->y_bearing = ink_top;
+	numeric->height = ink_bottom - ink_top;
+	numeric->overhang = ceil(overhang);
+	numeric->valid = true;
+}
+
+static struct fontcache_entry_t *fontcache_create_entry(const char *font_face, unsigned int font_size, bool font_bold, const cairo_font_options_t *options) {
+	if (fontcache_entry_count == fontcache_entry_alloced) {
+		unsigned int new_alloced = fontcache_entry_alloced ? (2 * fontcache_entry_alloced) : 16;
+		struct fontcache_entry_t **new_entries = realloc(fontcache_entries, sizeof(struct fontcache_entry_t*) * new_alloced);
+		if (!new_entries) {
+			perror("realloc");
+			return NULL;
+		}
+		fontcache_entries = new_entries;
+		fontcache_entry_alloced = new_alloced;
+	}
+
+	struct fontcache_entry_t *entry = calloc(sizeof(struct fontcache_entry_t), 1);
+	if (!entry) {
+		perror("calloc");
+		return NULL;
+	}
+	entry->font_face = strdup(font_face);
+	if (!entry->font_face) {
+		perror("strdup");
+		free(entry);
+		return NULL;
+	}
+	entry->font_size = font_size;
+	entry->font_bold = font_bold;
+	entry->options = options;
+
+	cairo_font_face_t *face = cairo_toy_font_face_create(font_face, CAIRO_FONT_SLANT_NORMAL, font_bold ? CAIRO_FONT_WEIGHT_BOLD : CAIRO_FONT_WEIGHT_NORMAL);
+	cairo_matrix_t font_matrix, ctm;
+	cairo_matrix_init_scale(&font_matrix, font_size, font_size);
+	cairo_matrix_init_identity(&ctm);
+	if (options) {
+		entry->scaled_font = cairo_scaled_font_create(face, &font_matrix, &ctm, options);
+	} else {
+		cairo_font_options_t *default_options = cairo_font_options_create();
+		entry->scaled_font = cairo_scaled_font_create(face, &font_matrix, &ctm, default_options);
+		cairo_font_options_destroy(default_options);
+	}
+	cairo_font_face_destroy(face);
+	cairo_scaled_font_extents(entry->scaled_font, &entry->font_extents);
+	fontcache_resolve_numeric(entry);
+
+	fontcache_entries[fontcache_entry_count++] = entry;
+	fontcache_stats.entries = fontcache_entry_count;
+	return entry;
+}
+
+/* Font options are identified by their address; they must stay valid until
+ * the cache is flushed. NULL gives Cairo's default options. */
+const struct fontcache_entry_t *fontcache_get(const char *font_face, unsigned int font_size, bool font_bold, const cairo_font_options_t *options) {
+	pthread_mutex_lock(&fontcache_mutex);
+	struct fontcache_entry_t *entry = fontcache_lookup(font_face, font_size, font_bold, options);
+	if (entry) {
+		fontcache_stats.hits++;
+	} else {
+		fontcache_stats.misses++;
+		entry = fontcache_create_entry(font_face, font_size, font_bold, options);
+	}
+	pthread_mutex_unlock(&fontcache_mutex);
+	return entry;
+}
+
+void fontcache_get_stats(struct fontcache_stats_t *stats) {
+	pthread_mutex_lock(&fontcache_mutex);
+	*stats = fontcache_stats;
+	pthread_mutex_unlock(&fontcache_mutex);
+}
+
+void fontcache_flush(void) {
+	pthread_mutex_lock(&fontcache_mutex);
+	for (unsigned int i = 0; i < fontcache_entry_count; i++) {
+		struct fontcache_entry_t *entry = fontcache_entries[i];
+		cairo_scaled_font_destroy(entry->scaled_font);
+		free(entry->font_face);
+		free(entry);
+	}
+	free(fontcache_entries);
+	fontcache_entries = NULL;
+	fontcache_entry_count = 0;
+	fontcache_entry_alloced = 0;
+	fontcache_stats.entries = 0;
+	pthread_mutex_unlock(&fontcache_mutex);
+}
@@ -0,0 +1,66 @@
+/*
+	pibeatsaber - Beat Saber historian application that tracks players
+	Copyright (C) 2019-2019 Johannes Bauer
+
+	This file is part of pibeatsaber.
+
+	pibeatsaber is free software; you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation; this program is ONLY licensed under
+	version 3 of the License, later versions are explicitly excluded.
+
+	pibeatsaber is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+	Johannes Bauer <JohannesBauer@gmx.de>
+*/
+
+#ifndef __FONTCACHE_H__
+#define __FONTCACHE_H__
+
+#include <stdbool.h>
+#include <cairo/cairo.h>
+
+#define FONTCACHE_NUMERIC_CHARS			"0123456789.%-"
+#define FONTCACHE_NUMERIC_CHAR_COUNT	13
+
+/* Glyphs needed to render numbers, resolved once per font. All digits are
+ * laid out in cells of the widest digit's advance (tabular figures). */
+struct fontcache_numeric_t {
+	bool valid;
+	unsigned long glyph_index[FONTCACHE_NUMERIC_CHAR_COUNT];
+	double advance[FONTCACHE_NUMERIC_CHAR_COUNT];
+	double digit_advance;
+	double y_bearing, height;
+	unsigned int overhang;
+};
+
+struct fontcache_entry_t {
+	char *font_face;
+	unsigned int font_size;
+	bool font_bold;
+	const cairo_font_options_t *options;
+	cairo_scaled_font_t *scaled_font;
+	cairo_font_extents_t font_extents;
+	struct fontcache_numeric_t numeric;
+};
+
+struct fontcache_stats_t {
+	unsigned int entries;
+	unsigned long long hits;
+	unsigned long long misses;
+};
+
+/*************** AUTO GENERATED SECTION FOLLOWS ***************/
+int fontcache_numeric_char_index(char c);
+const struct fontcache_entry_t *fontcache_get(const char *font_face, unsigned int font_size, bool font_bold, const cairo_font_options_t *options);
+void fontcache_get_stats(struct fontcache_stats_t *stats);
+void fontcache_flush(void);
+/***************  AUTO GENERATED SECTION ENDS   ***************/
+
+#endif
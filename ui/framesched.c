@@ -0,0 +1,146 @@
+/*
+	pibeatsaber - Beat Saber historian application that tracks players
+	Copyright (C) 2019-2019 Johannes Bauer
+
+	This file is part of pibeatsaber.
+
+	pibeatsaber is free software; you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation; this program is ONLY licensed under
+	version 3 of the License, later versions are explicitly excluded.
+
+	pibeatsaber is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+	Johannes Bauer <JohannesBauer@gmx.de>
+*/
+
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include "framesched.h"
+#include "tools.h"
+
+static void ns_to_timespec(struct timespec *ts, uint64_t ns) {
+	ts->tv_sec = ns / 1000000000;
+	ts->tv_nsec = ns % 1000000000;
+}
+
+static uint64_t fps_to_period_ns(unsigned int fps) {
+	return 1000000000ULL / (fps ? fps : 1);
+}
+
+/* Must be called with the mutex held */
+static void framesched_update_rate(struct framesched_t *sched, uint64_t now_ns) {
+	unsigned int fps = (now_ns < sched->active_until_ns) ? sched->policy.active_fps : sched->policy.idle_fps;
+	if (fps == 0) {
+		fps = 1;
+	}
+	if (fps != sched->fps) {
+		/* Re-anchor the grid at the last wakeup */
+		sched->fps = fps;
+		sched->period_ns = fps_to_period_ns(fps);
+		sched->next_deadline_ns = sched->last_wakeup_ns + sched->period_ns;
+		sched->stats.current_fps = fps;
+	}
+}
+
+bool framesched_init(struct framesched_t *sched, const struct framesched_policy_t *policy) {
+	memset(sched, 0, sizeof(*sched));
+	pthread_mutex_init(&sched->mutex, NULL);
+
+	pthread_condattr_t attr;
+	pthread_condattr_init(&attr);
+	if (pthread_condattr_setclock(&attr, CLOCK_MONOTONIC)) {
+		perror("pthread_condattr_setclock");
+		pthread_condattr_destroy(&attr);
+		return false;
+	}
+	pthread_cond_init(&sched->cond, &attr);
+	pthread_condattr_destroy(&attr);
+
+	sched->policy = *policy;
+	sched->last_wakeup_ns = now_monotonic_ns();
+	framesched_update_rate(sched, sched->last_wakeup_ns);
+	return true;
+}
+
+void framesched_set_policy(struct framesched_t *sched, const struct framesched_policy_t *policy) {
+	pthread_mutex_lock(&sched->mutex);
+	if (memcmp(&sched->policy, policy, sizeof(*policy))) {
+		sched->policy = *policy;
+		framesched_update_rate(sched, now_monotonic_ns());
+	}
+	pthread_mutex_unlock(&sched->mutex);
+}
+
+void framesched_interrupt(struct framesched_t *sched) {
+	pthread_mutex_lock(&sched->mutex);
+	sched->interrupted = true;
+	sched->active_until_ns = now_monotonic_ns() + (1000000ULL * sched->policy.active_hold_ms);
+	pthread_cond_signal(&sched->cond);
+	pthread_mutex_unlock(&sched->mutex);
+}
+
+/* Returns true if woken up early by framesched_interrupt(). An interrupt
+ * that arrives while nobody is waiting is not lost, but causes the next
+ * wait to return as soon as the active frame rate allows. */
+bool framesched_wait(struct framesched_t *sched) {
+	pthread_mutex_lock(&sched->mutex);
+	uint64_t now_ns = now_monotonic_ns();
+	while (true) {
+		framesched_update_rate(sched, now_ns);
+
+		uint64_t deadline_ns = sched->next_deadline_ns;
+		if (sched->interrupted) {
+			uint64_t earliest_ns = sched->last_wakeup_ns + fps_to_period_ns(sched->policy.active_fps);
+			if (earliest_ns < deadline_ns) {
+				deadline_ns = earliest_ns;
+			}
+		}
+		if (now_ns >= deadline_ns) {
+			break;
+		}
+
+		struct timespec abstime;
+		ns_to_timespec(&abstime, deadline_ns);
+		pthread_cond_timedwait(&sched->cond, &sched->mutex, &abstime);
+		now_ns = now_monotonic_ns();
+	}
+
+	bool interrupted = sched->interrupted;
+	sched->interrupted = false;
+	sched->last_wakeup_ns = now_ns;
+	if (now_ns >= sched->next_deadline_ns) {
+		/* Woken up by the frame grid */
+		uint64_t jitter_ns = now_ns - sched->next_deadline_ns;
+		uint64_t elapsed_periods = jitter_ns / sched->period_ns;
+		sched->stats.deadlines++;
+		sched->stats.jitter_sum_ns += jitter_ns;
+		if (jitter_ns > sched->stats.jitter_max_ns) {
+			sched->stats.jitter_max_ns = jitter_ns;
+		}
+		sched->stats.missed_deadlines += elapsed_periods;
+		sched->next_deadline_ns += (elapsed_periods + 1) * sched->period_ns;
+	} else {
+		sched->stats.interrupts++;
+	}
+	pthread_mutex_unlock(&sched->mutex);
+	return interrupted;
+}
+
+void framesched_get_stats(struct framesched_t *sched, struct framesched_stats_t *stats) {
+	pthread_mutex_lock(&sched->mutex);
+	*stats = sched->stats;
+	pthread_mutex_unlock(&sched->mutex);
+}
+
+void framesched_free(struct framesched_t *sched) {
+	pthread_mutex_destroy(&sched->mutex);
+	pthread_cond_destroy(&sched->cond);
+}
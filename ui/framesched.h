@@ -0,0 +1,76 @@
+/*
+	pibeatsaber - Beat Saber historian application that tracks players
+	Copyright (C) 2019-2019 Johannes Bauer
+
+	This file is part of pibeatsaber.
+
+	pibeatsaber is free software; you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation; this program is ONLY licensed under
+	version 3 of the License, later versions are explicitly excluded.
+
+	pibeatsaber is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+	Johannes Bauer <JohannesBauer@gmx.de>
+*/
+
+#ifndef __FRAMESCHED_H__
+#define __FRAMESCHED_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <pthread.h>
+
+struct framesched_policy_t {
+	unsigned int idle_fps;
+	unsigned int active_fps;
+	unsigned int active_hold_ms;
+};
+
+struct framesched_stats_t {
+	unsigned int current_fps;
+	unsigned int deadlines;
+	unsigned int interrupts;
+	unsigned int missed_deadlines;
+	uint64_t jitter_sum_ns;
+	uint64_t jitter_max_ns;
+};
+
+/* Paces frames on absolute CLOCK_MONOTONIC deadlines that are spaced one
+ * frame period apart, independently of how long rendering a frame took.
+ * Deadlines that have been missed entirely are skipped (and counted) instead
+ * of being caught up on.
+ *
+ * The frame rate follows a policy: an interrupt (i.e., an incoming event)
+ * wakes the waiter early, but no earlier than one active frame period after
+ * the previous wakeup, and switches to the active frame rate for the hold
+ * time. Afterwards the rate decays back to the idle frame rate. */
+struct framesched_t {
+	pthread_mutex_t mutex;
+	pthread_cond_t cond;
+	bool interrupted;
+	struct framesched_policy_t policy;
+	unsigned int fps;
+	uint64_t period_ns;
+	uint64_t active_until_ns;
+	uint64_t last_wakeup_ns;
+	uint64_t next_deadline_ns;
+	struct framesched_stats_t stats;
+};
+
+/*************** AUTO GENERATED SECTION FOLLOWS ***************/
+bool framesched_init(struct framesched_t *sched, const struct framesched_policy_t *policy);
+void framesched_set_policy(struct framesched_t *sched, const struct framesched_policy_t *policy);
+void framesched_interrupt(struct framesched_t *sched);
+bool framesched_wait(struct framesched_t *sched);
+void framesched_get_stats(struct framesched_t *sched, struct framesched_stats_t *stats);
+void framesched_free(struct framesched_t *sched);
+/***************  AUTO GENERATED SECTION ENDS   ***************/
+
+#endif
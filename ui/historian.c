@@ -33,6 +33,7 @@
 #include "historian.h"
 #include "jsondom.h"
 #include "tools.h"
+#include "perfstat.h"
 
 static bool truncate_crlf(char *string) {
 	int length = strlen(string);
@@ -62,38 +63,128 @@ static void historian_change_state(struct historian_t *historian, enum historian
 }
 
 
-static void handle_historian_connection(struct historian_t *historian) {
-	while (historian->running) {
-		char line_buffer[1024 * 16];
-		if (!fgets(line_buffer, sizeof(line_buffer), historian->f_read)) {
-			/* EOF */
-			break;
+/* Status messages contain the complete state and therefore supersede all
+ * previous ones. Detecting them does not require parsing the JSON, the
+ * historian always emits the msgtype key verbatim. */
+static bool is_status_message(const char *line) {
+	return strstr(line, "\"msgtype\": \"status\"") || strstr(line, "\"msgtype\":\"status\"");
+}
+
+static bool historian_handle_line(struct historian_t *historian, char *line, unsigned int msgno) {
+	/* Now try to parse the JSON message that we received */
+	uint64_t t0 = now_monotonic_ns();
+	struct jsondom_t *json = jsondom_parse(line);
+	t0 = perfstat_record(STAGE_HISTORIAN_PARSE, t0);
+	if (!json) {
+		fprintf(stderr, "Failed to parse server JSON, severing connection.\n");
+		fprintf(stderr, "RX: '%s'\n", line);
+		FILE *x = fopen("out.json", "w");
+		fwrite(line, 1, strlen(line), x);
+		fclose(x);
+		return false;
+	}
+
+	/* Event recived */
+	if (historian->event_callback) {
+		historian->event_callback(EVENT_HISTORIAN_MESSAGE, &((struct ui_event_historian_msg_t){ .historian = historian, .msgno = msgno, .json = json }), historian->event_callback_ctx);
+		perfstat_record(STAGE_HISTORIAN_APPLY, t0);
+	}
+	jsondom_free(json);
+	return true;
+}
+
+/* Handles all complete lines that are in the receive buffer in order. A run
+ * of consecutive status messages is collapsed so that only its newest one is
+ * parsed and applied; it is always applied before any message following it. */
+static bool historian_handle_rx_buffer(struct historian_t *historian) {
+	char *pending_status = NULL;
+	unsigned int pending_status_msgno = 0;
+	char *line = historian->rx_buffer;
+	char *buffer_end = historian->rx_buffer + historian->rx_fill;
+	char *newline;
+	while ((newline = memchr(line, '\n', buffer_end - line))) {
+		*newline = 0;
+		truncate_crlf(line);
+
+		/* Messages are numbered per connection, starting at 1 */
+		historian->rx_msgno++;
+		historian->stats.received++;
+
+		if (!line[0]) {
+			fprintf(stderr, "Received empty command line, severing connection.\n");
+			return false;
 		}
 
-		if (!truncate_crlf(line_buffer)) {
-			/* Either not complete line or empty line from the beginning */
-			fprintf(stderr, "Received improper command line, severing connection.\n");
-			historian->running = false;
-			break;
+		if (is_status_message(line)) {
+			if (pending_status) {
+				/* Superseded by a newer status message */
+				historian->stats.coalesced++;
+			}
+			pending_status = line;
+			pending_status_msgno = historian->rx_msgno;
+		} else {
+			if (pending_status) {
+				if (!historian_handle_line(historian, pending_status, pending_status_msgno)) {
+					return false;
+				}
+				pending_status = NULL;
+			}
+			if (!historian_handle_line(historian, line, historian->rx_msgno)) {
+				return false;
+			}
 		}
+		line = newline + 1;
+	}
+	char *remainder = line;
 
-		/* Now try to parse the JSON message that we received */
-		struct jsondom_t *json = jsondom_parse(line_buffer);
-		if (!json) {
-			fprintf(stderr, "Failed to parse server JSON, severing connection.\n");
-			fprintf(stderr, "RX: '%s'\n", line_buffer);
-			FILE *x = fopen("out.json", "w");
-			fwrite(line_buffer, 1, strlen(line_buffer), x);
-			fclose(x);
-			historian->running = false;
-			break;
+	if (pending_status && !historian_handle_line(historian, pending_status, pending_status_msgno)) {
+		return false;
+	}
+
+	/* Keep the incomplete line for the next read */
+	historian->rx_fill = buffer_end - remainder;
+	memmove(historian->rx_buffer, remainder, historian->rx_fill);
+	return true;
+}
+
+static void handle_historian_connection(struct historian_t *historian, int fd) {
+	historian->rx_fill = 0;
+	while (historian->running) {
+		/* Block for the first chunk of data, then pick up everything else that
+		 * has already queued up so that bursts can be coalesced */
+		int flags = 0;
+		while (historian->rx_fill < sizeof(historian->rx_buffer) - 1) {
+			ssize_t bytes_read = recv(fd, historian->rx_buffer + historian->rx_fill, sizeof(historian->rx_buffer) - 1 - historian->rx_fill, flags);
+			if (bytes_read == -1) {
+				if ((errno == EAGAIN) || (errno == EWOULDBLOCK)) {
+					break;
+				}
+				if (errno == EINTR) {
+					continue;
+				}
+				perror("recv");
+				return;
+			} else if (bytes_read == 0) {
+				/* EOF */
+				return;
+			}
+			historian->rx_fill += bytes_read;
+			flags = MSG_DONTWAIT;
 		}
 
-		/* Event recived */
-		if (historian->event_callback) {
-			historian->event_callback(EVENT_HISTORIAN_MESSAGE, &((struct ui_event_historian_msg_t){ .historian = historian, .json = json }), historian->event_callback_ctx);
+		if (!memchr(historian->rx_buffer, '\n', historian->rx_fill)) {
+			if (historian->rx_fill >= sizeof(historian->rx_buffer) - 1) {
+				fprintf(stderr, "Received overlong command line, severing connection.\n");
+				historian->running = false;
+				return;
+			}
+			continue;
+		}
+
+		if (!historian_handle_rx_buffer(historian)) {
+			historian->running = false;
+			return;
 		}
-		jsondom_free(json);
 	}
 }
 
@@ -127,36 +218,30 @@ static void* historian_connection_thread_fnc(void *vhistorian) {
 			continue;
 		}
 
+		/* Reading is done with recv() directly on the socket, only the write
+		 * side goes through stdio */
 		pthread_mutex_lock(&historian->f_mutex);
-		historian->f_read = fdopen(fd, "r");
-		if (!historian->f_read) {
-			perror("fdopen");
-			pthread_mutex_unlock(&historian->f_mutex);
-			close(fd);
-			close(dupfd);
-			sleep(3);
-			continue;
-		}
 		historian->f_write = fdopen(dupfd, "w");
 		if (!historian->f_write) {
 			perror("fdopen");
-			fclose(historian->f_read);
-			historian->f_read = NULL;
 			pthread_mutex_unlock(&historian->f_mutex);
+			close(fd);
 			close(dupfd);
 			sleep(3);
 			continue;
 		}
+		historian->fd = fd;
 		pthread_mutex_unlock(&historian->f_mutex);
 
+		historian->rx_msgno = 0;
 		historian_change_state(historian, CONNECTED);
-		handle_historian_connection(historian);
+		handle_historian_connection(historian, fd);
 		shutdown(fd, SHUT_RDWR);
 
 		pthread_mutex_lock(&historian->f_mutex);
-		fclose(historian->f_read);
+		close(historian->fd);
 		fclose(historian->f_write);
-		historian->f_read = NULL;
+		historian->fd = -1;
 		historian->f_write = NULL;
 		pthread_mutex_unlock(&historian->f_mutex);
 
@@ -174,6 +259,7 @@ struct historian_t *historian_connect(const char *unix_socket, ui_event_cb_t his
 
 	pthread_mutex_init(&historian->f_mutex, NULL);
 	historian->connection_state = UNCONNECTED;
+	historian->fd = -1;
 	historian->unix_socket = unix_socket;
 	historian->event_callback = historian_event_cb;
 	historian->event_callback_ctx = callback_ctx;
@@ -226,8 +312,8 @@ void historian_free(struct historian_t *historian) {
 	}
 	historian->running = false;
 	pthread_mutex_lock(&historian->f_mutex);
-	if (historian->f_read) {
-		shutdown(fileno(historian->f_read), SHUT_RDWR);
+	if (historian->fd != -1) {
+		shutdown(historian->fd, SHUT_RDWR);
 	}
 	pthread_mutex_unlock(&historian->f_mutex);
 	pthread_join(historian->connection_thread, NULL);
@@ -236,7 +322,7 @@ void historian_free(struct historian_t *historian) {
 
 #ifdef TEST_HISTORIAN
 
-// gcc -Wall -D_POSIX_C_SOURCE=200112L -D_XOPEN_SOURCE=500 -Wall -Wmissing-prototypes -Wstrict-prototypes -Werror=implicit-function-declaration -Werror=format -Wshadow -Wswitch -pthread -std=c11 -DTEST_HISTORIAN historian.c jsondom.c tools.c -o historian -ggdb3 -fsanitize=address -fsanitize=undefined -fsanitize=leak -fno-omit-frame-pointer -D_FORTITY_SOURCE=2 `pkg-config --cflags --libs yajl` && ./historian
+// gcc -Wall -D_POSIX_C_SOURCE=200112L -D_XOPEN_SOURCE=500 -Wall -Wmissing-prototypes -Wstrict-prototypes -Werror=implicit-function-declaration -Werror=format -Wshadow -Wswitch -pthread -std=c11 -DTEST_HISTORIAN historian.c jsondom.c tools.c perfstat.c -o historian -ggdb3 -fsanitize=address -fsanitize=undefined -fsanitize=leak -fno-omit-frame-pointer -D_FORTITY_SOURCE=2 `pkg-config --cflags --libs yajl` && ./historian
 
 static void event_callback(enum ui_eventtype_t event_type, void *event, void *ctx) {
 	if (event_type == EVENT_HISTORIAN_MESSAGE) {
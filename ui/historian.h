@@ -27,20 +27,32 @@
 #include <pthread.h>
 #include "ui_events.h"
 
+#define HISTORIAN_RX_BUFFER_SIZE		(1024 * 64)
+
 enum historian_state_t {
 	UNCONNECTED,
 	CONNECTED,
 };
 
+struct historian_stats_t {
+	unsigned int received;
+	unsigned int coalesced;
+};
+
 struct historian_t {
 	const char *unix_socket;
-	FILE *f_read, *f_write;
+	int fd;
+	FILE *f_write;
 	pthread_mutex_t f_mutex;
 	enum historian_state_t connection_state;
 	ui_event_cb_t event_callback;
 	void *event_callback_ctx;
 	pthread_t connection_thread;
 	pthread_t receive_thread;
+	unsigned int rx_msgno;
+	char rx_buffer[HISTORIAN_RX_BUFFER_SIZE];
+	unsigned int rx_fill;
+	struct historian_stats_t stats;
 	bool running;
 };
 
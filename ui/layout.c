@@ -0,0 +1,96 @@
+/*
+	pibeatsaber - Beat Saber historian application that tracks players
+	Copyright (C) 2019-2019 Johannes Bauer
+
+	This file is part of pibeatsaber.
+
+	pibeatsaber is free software; you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation; this program is ONLY licensed under
+	version 3 of the License, later versions are explicitly excluded.
+
+	pibeatsaber is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+	Johannes Bauer <JohannesBauer@gmx.de>
+*/
+
+#include <stddef.h>
+#include "layout.h"
+
+static void layout_resolve(struct layout_t *layout, const struct cairo_swbuf_t *surface) {
+	for (unsigned int i = 0; i < layout->element_count; i++) {
+		const struct layout_element_t *element = &layout->elements[i];
+		union layout_resolved_t *resolved = &layout->resolved[i];
+		switch (element->type) {
+			case LAYOUT_TEXT:
+				if (!swbuf_resolve_text(surface, &element->text, &resolved->text)) {
+					resolved->text.font = NULL;
+				}
+				break;
+
+			case LAYOUT_RECT: {
+				struct resolved_placement_t placement;
+				swbuf_resolve_placement(surface, &element->rect.placement, &placement);
+				resolved->rect_top_left = swbuf_place_resolved(&placement, element->rect.width, element->rect.height).top_left;
+				break;
+			}
+		}
+	}
+	layout->valid = true;
+	layout->width = surface->width;
+	layout->height = surface->height;
+	layout->font_options = surface->font_options;
+	layout->resolutions++;
+}
+
+static const union layout_resolved_t *layout_get(struct layout_t *layout, const struct cairo_swbuf_t *surface, unsigned int index) {
+	if (!layout->valid || (layout->width != surface->width) || (layout->height != surface->height) || (layout->font_options != surface->font_options)) {
+		layout_resolve(layout, surface);
+	}
+	return &layout->resolved[index];
+}
+
+/* Draws an element as described, i.e., with its fixed label and color */
+void layout_draw(struct layout_t *layout, struct cairo_swbuf_t *surface, unsigned int index) {
+	const struct layout_element_t *element = &layout->elements[index];
+	const union layout_resolved_t *resolved = layout_get(layout, surface, index);
+	switch (element->type) {
+		case LAYOUT_TEXT:
+			swbuf_text_at(surface, &resolved->text, element->text.font_color, "%s", element->label);
+			break;
+
+		case LAYOUT_RECT:
+			swbuf_rect_at(surface, &element->rect, element->rect.color, &resolved->rect_top_left);
+			break;
+	}
+}
+
+unsigned int layout_text(struct layout_t *layout, struct cairo_swbuf_t *surface, unsigned int index, uint32_t color, const char *fmt, ...) {
+	const union layout_resolved_t *resolved = layout_get(layout, surface, index);
+	va_list ap;
+	va_start(ap, fmt);
+	unsigned int width = swbuf_vtext_at(surface, &resolved->text, color, fmt, ap);
+	va_end(ap);
+	return width;
+}
+
+unsigned int layout_number(struct layout_t *layout, struct cairo_swbuf_t *surface, unsigned int index, uint32_t color, long value, unsigned int decimals, bool percent) {
+	const union layout_resolved_t *resolved = layout_get(layout, surface, index);
+	return swbuf_number_at(surface, &resolved->text, color, value, decimals, percent);
+}
+
+void layout_rect(struct layout_t *layout, struct cairo_swbuf_t *surface, unsigned int index, uint32_t color) {
+	const union layout_resolved_t *resolved = layout_get(layout, surface, index);
+	swbuf_rect_at(surface, &layout->elements[index].rect, color, &resolved->rect_top_left);
+}
+
+/* Resolved fonts become invalid when the font cache is flushed */
+void layout_invalidate(struct layout_t *layout) {
+	layout->valid = false;
+}
@@ -0,0 +1,78 @@
+/*
+	pibeatsaber - Beat Saber historian application that tracks players
+	Copyright (C) 2019-2019 Johannes Bauer
+
+	This file is part of pibeatsaber.
+
+	pibeatsaber is free software; you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation; this program is ONLY licensed under
+	version 3 of the License, later versions are explicitly excluded.
+
+	pibeatsaber is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+	Johannes Bauer <JohannesBauer@gmx.de>
+*/
+
+#ifndef __LAYOUT_H__
+#define __LAYOUT_H__
+
+#include <stdbool.h>
+#include <cairo/cairo.h>
+#include "cairo.h"
+
+enum layout_element_type_t {
+	LAYOUT_TEXT,
+	LAYOUT_RECT,
+};
+
+/* One element of a screen. Text elements either have a fixed label or get
+ * their content when they are drawn; rectangles have a fixed size. */
+struct layout_element_t {
+	enum layout_element_type_t type;
+	const char *label;
+	union {
+		struct font_placement_t text;
+		struct rect_placement_t rect;
+	};
+};
+
+union layout_resolved_t {
+	struct resolved_text_t text;
+	struct coordinate_t rect_top_left;
+};
+
+/* Describes a screen's elements once in a table. Everything that does not
+ * depend on the content, i.e., the destination anchors and offsets, the fonts
+ * and the absolute position of rectangles, is resolved whenever the surface
+ * size or font options change. Drawing then only needs to place the actual
+ * text according to its width. The storage for resolved elements must have
+ * as many entries as there are elements. Must only be used by one thread at
+ * a time. */
+struct layout_t {
+	const struct layout_element_t *elements;
+	unsigned int element_count;
+	bool valid;
+	unsigned int width, height;
+	const cairo_font_options_t *font_options;
+	unsigned int resolutions;
+	union layout_resolved_t *resolved;
+};
+
+#define LAYOUT_INITIALIZER(element_table, resolved_storage)		{ .elements = (element_table), .element_count = sizeof(element_table) / sizeof((element_table)[0]), .resolved = (resolved_storage) }
+
+/*************** AUTO GENERATED SECTION FOLLOWS ***************/
+void layout_draw(struct layout_t *layout, struct cairo_swbuf_t *surface, unsigned int index);
+unsigned int layout_text(struct layout_t *layout, struct cairo_swbuf_t *surface, unsigned int index, uint32_t color, const char *fmt, ...);
+unsigned int layout_number(struct layout_t *layout, struct cairo_swbuf_t *surface, unsigned int index, uint32_t color, long value, unsigned int decimals, bool percent);
+void layout_rect(struct layout_t *layout, struct cairo_swbuf_t *surface, unsigned int index, uint32_t color);
+void layout_invalidate(struct layout_t *layout);
+/***************  AUTO GENERATED SECTION ENDS   ***************/
+
+#endif
@@ -0,0 +1,120 @@
+/*
+	pibeatsaber - Beat Saber historian application that tracks players
+	Copyright (C) 2019-2019 Johannes Bauer
+
+	This file is part of pibeatsaber.
+
+	pibeatsaber is free software; you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation; this program is ONLY licensed under
+	version 3 of the License, later versions are explicitly excluded.
+
+	pibeatsaber is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+	Johannes Bauer <JohannesBauer@gmx.de>
+*/
+
+#include <stdatomic.h>
+#include "perfstat.h"
+#include "tools.h"
+
+struct perfstat_histogram_t {
+	atomic_uint_least64_t count;
+	atomic_uint_least64_t sum_ns;
+	atomic_uint_least64_t max_ns;
+	atomic_uint_least32_t buckets[PERFSTAT_BUCKET_COUNT];
+};
+
+static const char *stage_names[STAGE_COUNT] = {
+	[STAGE_RENDER] = "render",
+	[STAGE_BLIT] = "blit",
+	[STAGE_COMMIT] = "commit",
+	[STAGE_HISTORIAN_PARSE] = "historian parse",
+	[STAGE_HISTORIAN_APPLY] = "historian apply",
+};
+
+static struct perfstat_histogram_t histograms[STAGE_COUNT];
+
+static unsigned int perfstat_bucket_index(uint64_t value) {
+	if (value < (1 << PERFSTAT_SUBBUCKET_BITS)) {
+		return value;
+	}
+	unsigned int exponent = 63 - __builtin_clzll(value);
+	if (exponent > PERFSTAT_MAX_EXPONENT) {
+		return PERFSTAT_BUCKET_COUNT - 1;
+	}
+	unsigned int shift = exponent - PERFSTAT_SUBBUCKET_BITS;
+	unsigned int subbucket = (value >> shift) & ((1 << PERFSTAT_SUBBUCKET_BITS) - 1);
+	return ((shift + 1) << PERFSTAT_SUBBUCKET_BITS) + subbucket;
+}
+
+static uint64_t perfstat_bucket_upper_bound(unsigned int index) {
+	if (index < (1 << PERFSTAT_SUBBUCKET_BITS)) {
+		return index;
+	}
+	unsigned int shift = (index >> PERFSTAT_SUBBUCKET_BITS) - 1;
+	uint64_t mantissa = (1 << PERFSTAT_SUBBUCKET_BITS) | (index & ((1 << PERFSTAT_SUBBUCKET_BITS) - 1));
+	return ((mantissa + 1) << shift) - 1;
+}
+
+void perfstat_add(enum perfstat_stage_t stage, uint64_t duration_ns) {
+	struct perfstat_histogram_t *histogram = &histograms[stage];
+	atomic_fetch_add_explicit(&histogram->count, 1, memory_order_relaxed);
+	atomic_fetch_add_explicit(&histogram->sum_ns, duration_ns, memory_order_relaxed);
+	atomic_fetch_add_explicit(&histogram->buckets[perfstat_bucket_index(duration_ns)], 1, memory_order_relaxed);
+
+	uint_least64_t max_ns = atomic_load_explicit(&histogram->max_ns, memory_order_relaxed);
+	while ((duration_ns > max_ns) && !atomic_compare_exchange_weak_explicit(&histogram->max_ns, &max_ns, duration_ns, memory_order_relaxed, memory_order_relaxed));
+}
+
+/* Records the time elapsed since start_ns and returns the current timestamp,
+ * so that consecutive stages can be chained. */
+uint64_t perfstat_record(enum perfstat_stage_t stage, uint64_t start_ns) {
+	uint64_t now_ns = now_monotonic_ns();
+	perfstat_add(stage, now_ns - start_ns);
+	return now_ns;
+}
+
+uint64_t perfstat_percentile(enum perfstat_stage_t stage, double percentile) {
+	struct perfstat_histogram_t *histogram = &histograms[stage];
+	uint64_t count = atomic_load_explicit(&histogram->count, memory_order_relaxed);
+	if (!count) {
+		return 0;
+	}
+
+	uint64_t threshold = (count * percentile / 100) + 0.5;
+	if (threshold < 1) {
+		threshold = 1;
+	}
+	uint64_t seen = 0;
+	for (unsigned int i = 0; i < PERFSTAT_BUCKET_COUNT; i++) {
+		seen += atomic_load_explicit(&histogram->buckets[i], memory_order_relaxed);
+		if (seen >= threshold) {
+			uint64_t upper_bound = perfstat_bucket_upper_bound(i);
+			uint64_t max_ns = atomic_load_explicit(&histogram->max_ns, memory_order_relaxed);
+			return (upper_bound < max_ns) ? upper_bound : max_ns;
+		}
+	}
+	return atomic_load_explicit(&histogram->max_ns, memory_order_relaxed);
+}
+
+void perfstat_dump(FILE *f) {
+	fprintf(f, "%-20s %8s %10s %10s %10s %10s %10s\n", "Stage [ms]", "count", "avg", "p50", "p90", "p99", "max");
+	for (unsigned int i = 0; i < STAGE_COUNT; i++) {
+		struct perfstat_histogram_t *histogram = &histograms[i];
+		uint64_t count = atomic_load_explicit(&histogram->count, memory_order_relaxed);
+		if (!count) {
+			fprintf(f, "%-20s %8d\n", stage_names[i], 0);
+			continue;
+		}
+		uint64_t sum_ns = atomic_load_explicit(&histogram->sum_ns, memory_order_relaxed);
+		uint64_t max_ns = atomic_load_explicit(&histogram->max_ns, memory_order_relaxed);
+		fprintf(f, "%-20s %8llu %10.3f %10.3f %10.3f %10.3f %10.3f\n", stage_names[i], (unsigned long long)count, sum_ns / 1e6 / count, perfstat_percentile(i, 50) / 1e6, perfstat_percentile(i, 90) / 1e6, perfstat_percentile(i, 99) / 1e6, max_ns / 1e6);
+	}
+}
@@ -0,0 +1,51 @@
+/*
+	pibeatsaber - Beat Saber historian application that tracks players
+	Copyright (C) 2019-2019 Johannes Bauer
+
+	This file is part of pibeatsaber.
+
+	pibeatsaber is free software; you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation; this program is ONLY licensed under
+	version 3 of the License, later versions are explicitly excluded.
+
+	pibeatsaber is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+	Johannes Bauer <JohannesBauer@gmx.de>
+*/
+
+#ifndef __PERFSTAT_H__
+#define __PERFSTAT_H__
+
+#include <stdio.h>
+#include <stdint.h>
+
+/* Durations are binned log-linearly: 8 bins per power of two, which gives a
+ * resolution of 12.5% across the whole range up to 2^40 ns (~18 minutes). */
+#define PERFSTAT_SUBBUCKET_BITS		3
+#define PERFSTAT_MAX_EXPONENT		40
+#define PERFSTAT_BUCKET_COUNT		((PERFSTAT_MAX_EXPONENT - PERFSTAT_SUBBUCKET_BITS + 2) << PERFSTAT_SUBBUCKET_BITS)
+
+enum perfstat_stage_t {
+	STAGE_RENDER,
+	STAGE_BLIT,
+	STAGE_COMMIT,
+	STAGE_HISTORIAN_PARSE,
+	STAGE_HISTORIAN_APPLY,
+	STAGE_COUNT,
+};
+
+/*************** AUTO GENERATED SECTION FOLLOWS ***************/
+void perfstat_add(enum perfstat_stage_t stage, uint64_t duration_ns);
+uint64_t perfstat_record(enum perfstat_stage_t stage, uint64_t start_ns);
+uint64_t perfstat_percentile(enum perfstat_stage_t stage, double percentile);
+void perfstat_dump(FILE *f);
+/***************  AUTO GENERATED SECTION ENDS   ***************/
+
+#endif
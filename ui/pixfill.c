@@ -0,0 +1,118 @@
+/*
+	pibeatsaber - Beat Saber historian application that tracks players
+	Copyright (C) 2019-2019 Johannes Bauer
+
+	This file is part of pibeatsaber.
+
+	pibeatsaber is free software; you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation; this program is ONLY licensed under
+	version 3 of the License, later versions are explicitly excluded.
+
+	pibeatsaber is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+	Johannes Bauer <JohannesBauer@gmx.de>
+*/
+
+#include "pixfill.h"
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#define PIXFILL_IMPLEMENTATION		"SSE2"
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#define PIXFILL_IMPLEMENTATION		"NEON"
+#else
+#define PIXFILL_IMPLEMENTATION		"scalar"
+#endif
+
+const char *pixfill_implementation(void) {
+	return PIXFILL_IMPLEMENTATION;
+}
+
+void pixfill_span32(uint32_t *dest, unsigned int count, uint32_t pixel) {
+#if defined(__SSE2__)
+	/* Align the destination to 16 bytes first */
+	while (count && ((uintptr_t)dest & 15)) {
+		*dest++ = pixel;
+		count--;
+	}
+	const __m128i value = _mm_set1_epi32(pixel);
+	while (count >= 16) {
+		_mm_store_si128((__m128i*)dest + 0, value);
+		_mm_store_si128((__m128i*)dest + 1, value);
+		_mm_store_si128((__m128i*)dest + 2, value);
+		_mm_store_si128((__m128i*)dest + 3, value);
+		dest += 16;
+		count -= 16;
+	}
+	while (count >= 4) {
+		_mm_store_si128((__m128i*)dest, value);
+		dest += 4;
+		count -= 4;
+	}
+#elif defined(__ARM_NEON)
+	const uint32x4_t value = vdupq_n_u32(pixel);
+	while (count >= 16) {
+		vst1q_u32(dest + 0, value);
+		vst1q_u32(dest + 4, value);
+		vst1q_u32(dest + 8, value);
+		vst1q_u32(dest + 12, value);
+		dest += 16;
+		count -= 16;
+	}
+	while (count >= 4) {
+		vst1q_u32(dest, value);
+		dest += 4;
+		count -= 4;
+	}
+#endif
+	while (count) {
+		*dest++ = pixel;
+		count--;
+	}
+}
+
+/* Fills pairs of pixels with 32 bit stores */
+void pixfill_span16(uint16_t *dest, unsigned int count, uint16_t pixel) {
+	if (count && ((uintptr_t)dest & 2)) {
+		*dest++ = pixel;
+		count--;
+	}
+	pixfill_span32((uint32_t*)dest, count / 2, ((uint32_t)pixel << 16) | pixel);
+	if (count & 1) {
+		dest[count - 1] = pixel;
+	}
+}
+
+/* Stride is given in bytes, coordinates in pixels */
+void pixfill_rect32(uint8_t *data, unsigned int stride, unsigned int x, unsigned int y, unsigned int width, unsigned int height, uint32_t pixel) {
+	uint8_t *row = data + (y * stride) + (x * sizeof(uint32_t));
+	if (stride == width * sizeof(uint32_t)) {
+		/* Contiguous, fill in one go */
+		pixfill_span32((uint32_t*)row, width * height, pixel);
+		return;
+	}
+	for (unsigned int i = 0; i < height; i++) {
+		pixfill_span32((uint32_t*)row, width, pixel);
+		row += stride;
+	}
+}
+
+void pixfill_rect16(uint8_t *data, unsigned int stride, unsigned int x, unsigned int y, unsigned int width, unsigned int height, uint16_t pixel) {
+	uint8_t *row = data + (y * stride) + (x * sizeof(uint16_t));
+	if (stride == width * sizeof(uint16_t)) {
+		pixfill_span16((uint16_t*)row, width * height, pixel);
+		return;
+	}
+	for (unsigned int i = 0; i < height; i++) {
+		pixfill_span16((uint16_t*)row, width, pixel);
+		row += stride;
+	}
+}
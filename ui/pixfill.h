@@ -0,0 +1,36 @@
+/*
+	pibeatsaber - Beat Saber historian application that tracks players
+	Copyright (C) 2019-2019 Johannes Bauer
+
+	This file is part of pibeatsaber.
+
+	pibeatsaber is free software; you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation; this program is ONLY licensed under
+	version 3 of the License, later versions are explicitly excluded.
+
+	pibeatsaber is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+	Johannes Bauer <JohannesBauer@gmx.de>
+*/
+
+#ifndef __PIXFILL_H__
+#define __PIXFILL_H__
+
+#include <stdint.h>
+
+/*************** AUTO GENERATED SECTION FOLLOWS ***************/
+const char *pixfill_implementation(void);
+void pixfill_span32(uint32_t *dest, unsigned int count, uint32_t pixel);
+void pixfill_span16(uint16_t *dest, unsigned int count, uint16_t pixel);
+void pixfill_rect32(uint8_t *data, unsigned int stride, unsigned int x, unsigned int y, unsigned int width, unsigned int height, uint32_t pixel);
+void pixfill_rect16(uint8_t *data, unsigned int stride, unsigned int x, unsigned int y, unsigned int width, unsigned int height, uint16_t pixel);
+/***************  AUTO GENERATED SECTION ENDS   ***************/
+
+#endif
@@ -0,0 +1,55 @@
+/*
+	pibeatsaber - Beat Saber historian application that tracks players
+	Copyright (C) 2019-2019 Johannes Bauer
+
+	This file is part of pibeatsaber.
+
+	pibeatsaber is free software; you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation; this program is ONLY licensed under
+	version 3 of the License, later versions are explicitly excluded.
+
+	pibeatsaber is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+	Johannes Bauer <JohannesBauer@gmx.de>
+*/
+
+#include <stdio.h>
+#include <string.h>
+#include "profilegov.h"
+
+void profilegov_init(struct profilegov_t *gov, enum render_profile_t profile, bool automatic) {
+	memset(gov, 0, sizeof(*gov));
+	gov->profile = profile;
+	gov->automatic = automatic;
+}
+
+/* Returns true if the profile was changed */
+bool profilegov_record(struct profilegov_t *gov, uint64_t render_ns, unsigned int fps) {
+	if (!gov->automatic || (fps == 0) || (gov->profile == RENDER_PROFILE_FAST)) {
+		return false;
+	}
+
+	const uint64_t budget_ns = 1000000000ULL / fps * PROFILEGOV_BUDGET_PERCENT / 100;
+	if (render_ns <= budget_ns) {
+		gov->over_budget_frames = 0;
+		return false;
+	}
+
+	gov->over_budget_frames++;
+	if (gov->over_budget_frames < PROFILEGOV_OVER_BUDGET_FRAMES) {
+		return false;
+	}
+
+	fprintf(stderr, "Rendering takes %.1f ms at %u fps (budget %.1f ms), switching from \"%s\" to \"%s\" profile.\n", render_ns / 1e6, fps, budget_ns / 1e6, render_profile_name(gov->profile), render_profile_name(gov->profile + 1));
+	gov->profile++;
+	gov->over_budget_frames = 0;
+	gov->downgrades++;
+	return true;
+}
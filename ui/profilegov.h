@@ -0,0 +1,49 @@
+/*
+	pibeatsaber - Beat Saber historian application that tracks players
+	Copyright (C) 2019-2019 Johannes Bauer
+
+	This file is part of pibeatsaber.
+
+	pibeatsaber is free software; you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation; this program is ONLY licensed under
+	version 3 of the License, later versions are explicitly excluded.
+
+	pibeatsaber is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+	Johannes Bauer <JohannesBauer@gmx.de>
+*/
+
+#ifndef __PROFILEGOV_H__
+#define __PROFILEGOV_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "cairo.h"
+
+#define PROFILEGOV_BUDGET_PERCENT			75
+#define PROFILEGOV_OVER_BUDGET_FRAMES		30
+
+/* Picks the render profile. When automatic, a render time that keeps
+ * exceeding the share of the frame period given by the budget for a number
+ * of consecutive frames steps down to the next faster profile. There is no
+ * way back up: a profile that was too slow once would be again. */
+struct profilegov_t {
+	enum render_profile_t profile;
+	bool automatic;
+	unsigned int over_budget_frames;
+	unsigned int downgrades;
+};
+
+/*************** AUTO GENERATED SECTION FOLLOWS ***************/
+void profilegov_init(struct profilegov_t *gov, enum render_profile_t profile, bool automatic);
+bool profilegov_record(struct profilegov_t *gov, uint64_t render_ns, unsigned int fps);
+/***************  AUTO GENERATED SECTION ENDS   ***************/
+
+#endif
@@ -0,0 +1,479 @@
+/*
+	pibeatsaber - Beat Saber historian application that tracks players
+	Copyright (C) 2019-2019 Johannes Bauer
+
+	This file is part of pibeatsaber.
+
+	pibeatsaber is free software; you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation; this program is ONLY licensed under
+	version 3 of the License, later versions are explicitly excluded.
+
+	pibeatsaber is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+	Johannes Bauer <JohannesBauer@gmx.de>
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <time.h>
+#include "cairo.h"
+#include "cyberblades-ui.h"
+#include "renderer_fullhd.h"
+#include "tools.h"
+#include "fontcache.h"
+#include "textcache.h"
+#include "spritecache.h"
+#include "pixfill.h"
+#include "tilerender.h"
+
+enum bench_scenario_t {
+	SCENARIO_MAIN,
+	SCENARIO_GAME,
+	SCENARIO_LONG_NAMES,
+	SCENARIO_COUNT,
+};
+
+static const char *scenario_names[SCENARIO_COUNT] = {
+	[SCENARIO_MAIN] = "main",
+	[SCENARIO_GAME] = "game",
+	[SCENARIO_LONG_NAMES] = "long",
+};
+
+static void fill_string(char *dest, unsigned int dest_size, const char *pattern) {
+	unsigned int pattern_length = strlen(pattern);
+	for (unsigned int i = 0; i < dest_size - 1; i++) {
+		dest[i] = pattern[i % pattern_length];
+	}
+	dest[dest_size - 1] = 0;
+}
+
+static void generate_performance(struct performance_info_t *performance, unsigned int seed) {
+	performance->max_score = 900000 + (seed * 1234);
+	performance->score = performance->max_score - (seed * 7919 % 200000);
+	performance->max_combo = 200 + (seed * 31 % 500);
+	performance->combo = performance->max_combo / 2;
+	performance->passed_notes = 400 + (seed * 13 % 300);
+	performance->missed_notes = seed % 17;
+	performance->hit_notes = performance->passed_notes - performance->missed_notes;
+	performance->verdict_passed = (seed % 5) != 0;
+	strcpy(performance->rank, (seed % 3) ? "SS" : "A");
+}
+
+static void generate_state(struct render_state_t *state, enum bench_scenario_t scenario) {
+	memset(state, 0, sizeof(*state));
+	state->historian_state = CONNECTED;
+	state->connected_to_beatsaber = true;
+	state->ui_screen = (scenario == SCENARIO_GAME) ? GAME_SCREEN : MAIN_SCREEN;
+
+	if (scenario == SCENARIO_LONG_NAMES) {
+		fill_string(state->player.name, sizeof(state->player.name), "Maximilian ");
+		fill_string(state->highscores.song_key.song_author, sizeof(state->highscores.song_key.song_author), "Camellia ");
+		fill_string(state->highscores.song_key.song_title, sizeof(state->highscores.song_key.song_title), "Ghost (Extended Mix) ");
+	} else {
+		strcpy(state->player.name, "Joe");
+		strcpy(state->highscores.song_key.song_author, "Jaroslav Beck");
+		strcpy(state->highscores.song_key.song_title, "Beat Saber");
+	}
+	state->highscores.song_key.difficulty = EXPERT;
+
+	state->player.today = (struct player_stats_t) {
+		.games_played = 12,
+		.total_playtime_secs = 2345,
+		.total_score = 8123456,
+		.total_max_score = 9876543,
+		.total_passed_notes = 5432,
+		.total_missed_notes = 123,
+	};
+	state->player.alltime = (struct player_stats_t) {
+		.games_played = 1234,
+		.total_playtime_secs = 234567,
+		.total_score = 812345678,
+		.total_max_score = 987654321,
+		.total_passed_notes = 543210,
+		.total_missed_notes = 12345,
+	};
+
+	state->highscores.version = 1 + scenario;
+	state->highscores.entry_count = MAX_HIGHSCORE_ENTRY_COUNT;
+	for (unsigned int i = 0; i < MAX_HIGHSCORE_ENTRY_COUNT; i++) {
+		struct highscore_entry_t *entry = &state->highscores.entries[i];
+		entry->number = i + 1;
+		if (scenario == SCENARIO_LONG_NAMES) {
+			fill_string(entry->name, sizeof(entry->name), "Bartholomew ");
+		} else {
+			snprintf(entry->name, sizeof(entry->name), "Player %u", i + 1);
+		}
+		entry->most_recent = (i == 3);
+		generate_performance(&entry->performance, i + 1);
+	}
+
+	strcpy(state->current_song.meta.song_author, state->highscores.song_key.song_author);
+	strcpy(state->current_song.meta.song_title, state->highscores.song_key.song_title);
+	generate_performance(&state->current_song.performance, 42);
+}
+
+/* Emulates what the historian sends during a game: every frame, a few more
+ * notes have been cut and the score went up */
+static void advance_game(struct render_state_t *state, unsigned int iteration) {
+	struct performance_info_t *performance = &state->current_song.performance;
+	performance->passed_notes = iteration;
+	performance->missed_notes = iteration / 37;
+	performance->hit_notes = performance->passed_notes - performance->missed_notes;
+	performance->combo = iteration % 37;
+	if (performance->combo > performance->max_combo) {
+		performance->max_combo = performance->combo;
+	}
+	performance->score = iteration * 115;
+	performance->max_score = iteration * 120;
+	state->generation++;
+}
+
+static uint64_t cputime_ns(void) {
+	struct timespec ts;
+	clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts);
+	return ((uint64_t)ts.tv_sec * 1000000000) + ts.tv_nsec;
+}
+
+static int compare_uint64(const void *va, const void *vb) {
+	uint64_t a = *(const uint64_t*)va;
+	uint64_t b = *(const uint64_t*)vb;
+	return (a > b) - (a < b);
+}
+
+static uint64_t percentile(const uint64_t *sorted, unsigned int count, double percentile) {
+	unsigned int index = (count - 1) * percentile / 100 + 0.5;
+	return sorted[index];
+}
+
+static void run_scenario(enum bench_scenario_t scenario, struct cairo_swbuf_t *swbuf, unsigned int iterations, const char *dump_prefix) {
+	struct render_state_t state;
+	generate_state(&state, scenario);
+
+	uint64_t *durations = calloc(iterations, sizeof(uint64_t));
+	if (!durations) {
+		perror("calloc");
+		exit(EXIT_FAILURE);
+	}
+
+	/* Warm up caches so we measure steady state */
+	swbuf_render_full_hd(&state, swbuf);
+
+	uint64_t cpu_t0 = cputime_ns();
+	uint64_t wall_t0 = now_monotonic_ns();
+	for (unsigned int i = 0; i < iterations; i++) {
+		if (scenario == SCENARIO_GAME) {
+			advance_game(&state, i);
+		}
+		uint64_t t0 = now_monotonic_ns();
+		swbuf_render_full_hd(&state, swbuf);
+		durations[i] = now_monotonic_ns() - t0;
+	}
+	uint64_t wall_ns = now_monotonic_ns() - wall_t0;
+	uint64_t cpu_ns = cputime_ns() - cpu_t0;
+
+	qsort(durations, iterations, sizeof(uint64_t), compare_uint64);
+	printf("%-6s %6u frames %8.1f fps   p50 %7.3f ms  p90 %7.3f ms  p99 %7.3f ms  max %7.3f ms   CPU %7.3f ms/frame\n",
+			scenario_names[scenario], iterations, iterations / (wall_ns / 1e9),
+			percentile(durations, iterations, 50) / 1e6,
+			percentile(durations, iterations, 90) / 1e6,
+			percentile(durations, iterations, 99) / 1e6,
+			durations[iterations - 1] / 1e6,
+			cpu_ns / 1e6 / iterations);
+	free(durations);
+
+	if (dump_prefix) {
+		char filename[256];
+		snprintf(filename, sizeof(filename), "%s%s.png", dump_prefix, scenario_names[scenario]);
+		swbuf_dump(swbuf, filename);
+	}
+}
+
+#define SCALING_MAX_THREADS		4
+
+#define FILL_BENCH_RECTS_X		8
+#define FILL_BENCH_RECTS_Y		8
+
+static void fill_rects_cairo(struct cairo_swbuf_t *swbuf) {
+	unsigned int rect_width = swbuf->width / FILL_BENCH_RECTS_X / 2;
+	unsigned int rect_height = swbuf->height / FILL_BENCH_RECTS_Y / 2;
+	for (unsigned int y = 0; y < FILL_BENCH_RECTS_Y; y++) {
+		for (unsigned int x = 0; x < FILL_BENCH_RECTS_X; x++) {
+			cairo_set_source_rgb(swbuf->ctx, 0.25, 0.5, 0.75);
+			cairo_rectangle(swbuf->ctx, 2 * x * rect_width, 2 * y * rect_height, rect_width, rect_height);
+			cairo_fill(swbuf->ctx);
+		}
+	}
+}
+
+static void fill_rects_swbuf(struct cairo_swbuf_t *swbuf) {
+	struct rect_placement_t placement = {
+		.width = swbuf->width / FILL_BENCH_RECTS_X / 2,
+		.height = swbuf->height / FILL_BENCH_RECTS_Y / 2,
+		.color = 0x4080c0,
+		.fill = true,
+	};
+	for (unsigned int y = 0; y < FILL_BENCH_RECTS_Y; y++) {
+		for (unsigned int x = 0; x < FILL_BENCH_RECTS_X; x++) {
+			placement.placement.xoffset = 2 * x * placement.width;
+			placement.placement.yoffset = 2 * y * placement.height;
+			swbuf_rect(swbuf, &placement);
+		}
+	}
+}
+
+static double time_fill_ms(struct cairo_swbuf_t *swbuf, unsigned int iterations, void (*fill)(struct cairo_swbuf_t *swbuf)) {
+	fill(swbuf);
+	uint64_t t0 = now_monotonic_ns();
+	for (unsigned int i = 0; i < iterations; i++) {
+		fill(swbuf);
+	}
+	return (now_monotonic_ns() - t0) / 1e6 / iterations;
+}
+
+static void clear_cairo(struct cairo_swbuf_t *swbuf) {
+	cairo_set_source_rgb(swbuf->ctx, 0, 0, 0);
+	cairo_rectangle(swbuf->ctx, 0, 0, swbuf->width, swbuf->height);
+	cairo_fill(swbuf->ctx);
+}
+
+static void clear_swbuf(struct cairo_swbuf_t *swbuf) {
+	swbuf_clear(swbuf, 0x000000);
+}
+
+/* Compares the Cairo rasterizer against the direct pixel fill for the
+ * resolutions the UI actually runs at */
+static void run_fill_benchmark(unsigned int iterations, unsigned int bits_per_pixel) {
+	static const struct {
+		unsigned int width, height;
+	} resolutions[] = {
+		{ 1920, 1080 },
+		{ 320, 240 },
+	};
+
+	printf("Pixel fill implementation: %s, %u bpp\n", pixfill_implementation(), bits_per_pixel);
+	for (unsigned int i = 0; i < sizeof(resolutions) / sizeof(resolutions[0]); i++) {
+		struct cairo_swbuf_t *swbuf = create_swbuf(resolutions[i].width, resolutions[i].height, bits_per_pixel);
+		if (!swbuf) {
+			fprintf(stderr, "Could not create %u x %u software buffer.\n", resolutions[i].width, resolutions[i].height);
+			exit(EXIT_FAILURE);
+		}
+		double clear_cairo_ms = time_fill_ms(swbuf, iterations, clear_cairo);
+		double clear_swbuf_ms = time_fill_ms(swbuf, iterations, clear_swbuf);
+		double rects_cairo_ms = time_fill_ms(swbuf, iterations, fill_rects_cairo);
+		double rects_swbuf_ms = time_fill_ms(swbuf, iterations, fill_rects_swbuf);
+		printf("%4u x %4u   clear: Cairo %7.3f ms, direct %7.3f ms (%.1fx)   %u rects: Cairo %7.3f ms, direct %7.3f ms (%.1fx)\n",
+				resolutions[i].width, resolutions[i].height,
+				clear_cairo_ms, clear_swbuf_ms, clear_cairo_ms / clear_swbuf_ms,
+				FILL_BENCH_RECTS_X * FILL_BENCH_RECTS_Y, rects_cairo_ms, rects_swbuf_ms, rects_cairo_ms / rects_swbuf_ms);
+		free_swbuf(swbuf);
+	}
+}
+
+static void usage(const char *progname) {
+	fprintf(stderr, "%s [-n iterations] [-s scenario] [-W WxH] [-B bpp] [-R] [-T threads[:tiles]] [-P profile] [-p] [-e fontfile] [-S] [-F] [-o prefix]\n", progname);
+	fprintf(stderr, "\n");
+	fprintf(stderr, "  -n iterations  Number of frames to render per scenario. Defaults to 200.\n");
+	fprintf(stderr, "  -s scenario    Only run the given scenario (main, game or long). By\n");
+	fprintf(stderr, "                 default, all scenarios are run.\n");
+	fprintf(stderr, "  -W WxH         Resolution to render at. Defaults to 1920x1080.\n");
+	fprintf(stderr, "  -B bpp         Pixel format of the buffer, 32 (ARGB) or 16 (RGB565). Defaults\n");
+	fprintf(stderr, "                 to 32.\n");
+	fprintf(stderr, "  -R             Render in retained mode, i.e., record a display list and\n");
+	fprintf(stderr, "                 only redraw operations that changed since the last frame.\n");
+	fprintf(stderr, "  -T threads[:tiles]\n");
+	fprintf(stderr, "                 Rasterize in horizontal bands on the given number of worker\n");
+	fprintf(stderr, "                 threads. Defaults to %d bands.\n", TILERENDER_DEFAULT_TILES);
+	fprintf(stderr, "  -P profile     Render profile, quality, balanced or fast. \"all\" runs the\n");
+	fprintf(stderr, "                 scenarios once with every profile. Defaults to quality.\n");
+	fprintf(stderr, "  -p             Use a private fontconfig configuration with only the bundled\n");
+	fprintf(stderr, "                 fonts and those given by -e.\n");
+	fprintf(stderr, "  -e fontfile    Additional font file to load. Can be given up to %d times.\n", MAX_EXTRA_FONTS);
+	fprintf(stderr, "  -S             Run all scenarios with tiled rendering on 1 to %d threads\n", SCALING_MAX_THREADS);
+	fprintf(stderr, "                 to show how rendering scales.\n");
+	fprintf(stderr, "  -F             Instead of rendering scenarios, compare solid fills through\n");
+	fprintf(stderr, "                 Cairo against the direct pixel fill fast path.\n");
+	fprintf(stderr, "  -o prefix      Write the last frame of each scenario to <prefix><scenario>.png\n");
+}
+
+int main(int argc, char **argv) {
+	const uint64_t startup_ns = now_monotonic_ns();
+	unsigned int iterations = 200;
+	unsigned int width = 1920, height = 1080;
+	unsigned int bits_per_pixel = 32;
+	int only_scenario = -1;
+	const char *dump_prefix = NULL;
+	bool fill_benchmark = false;
+	bool scaling_benchmark = false;
+	unsigned int tiled_threads = 0, tiled_tiles = TILERENDER_DEFAULT_TILES;
+	enum render_profile_t first_profile = RENDER_PROFILE_QUALITY;
+	enum render_profile_t last_profile = RENDER_PROFILE_QUALITY;
+	bool private_fontconfig = false;
+	char *extra_fonts[MAX_EXTRA_FONTS];
+	unsigned int extra_font_count = 0;
+
+	int opt;
+	while ((opt = getopt(argc, argv, "n:s:W:B:RT:P:pe:SFo:")) != -1) {
+		switch (opt) {
+			case 'n':
+				iterations = atoi(optarg);
+				break;
+
+			case 's':
+				for (unsigned int i = 0; i < SCENARIO_COUNT; i++) {
+					if (!strcmp(optarg, scenario_names[i])) {
+						only_scenario = i;
+					}
+				}
+				if (only_scenario == -1) {
+					fprintf(stderr, "Unknown scenario: %s\n", optarg);
+					exit(EXIT_FAILURE);
+				}
+				break;
+
+			case 'W':
+				if (sscanf(optarg, "%ux%u", &width, &height) != 2) {
+					fprintf(stderr, "Invalid resolution: %s\n", optarg);
+					exit(EXIT_FAILURE);
+				}
+				break;
+
+			case 'B':
+				bits_per_pixel = atoi(optarg);
+				break;
+
+			case 'R':
+				renderer_full_hd_set_retained(true);
+				break;
+
+			case 'T':
+				if (!tilerender_parse_spec(optarg, &tiled_threads, &tiled_tiles)) {
+					fprintf(stderr, "Invalid tiled rendering specification: %s\n", optarg);
+					exit(EXIT_FAILURE);
+				}
+				break;
+
+			case 'P':
+				if (!strcmp(optarg, "all")) {
+					first_profile = 0;
+					last_profile = RENDER_PROFILE_COUNT - 1;
+				} else if (render_profile_parse(optarg, &first_profile)) {
+					last_profile = first_profile;
+				} else {
+					fprintf(stderr, "Unknown render profile: %s\n", optarg);
+					exit(EXIT_FAILURE);
+				}
+				break;
+
+			case 'p':
+				private_fontconfig = true;
+				break;
+
+			case 'e':
+				if (extra_font_count == MAX_EXTRA_FONTS) {
+					fprintf(stderr, "Too many extra fonts, at most %d are supported.\n", MAX_EXTRA_FONTS);
+					exit(EXIT_FAILURE);
+				}
+				extra_fonts[extra_font_count++] = optarg;
+				break;
+
+			case 'S':
+				scaling_benchmark = true;
+				break;
+
+			case 'F':
+				fill_benchmark = true;
+				break;
+
+			case 'o':
+				dump_prefix = optarg;
+				break;
+
+			default:
+				usage(argv[0]);
+				exit(EXIT_FAILURE);
+		}
+	}
+	if (iterations == 0) {
+		usage(argv[0]);
+		exit(EXIT_FAILURE);
+	}
+
+	if (fill_benchmark) {
+		run_fill_benchmark(iterations, bits_per_pixel);
+		cairo_cleanup();
+		return 0;
+	}
+
+	uint64_t fonts_loaded_ns = now_monotonic_ns();
+	if (!renderer_full_hd_load_fonts(private_fontconfig, extra_fonts, extra_font_count)) {
+		fprintf(stderr, "Could not set up fonts.\n");
+		exit(EXIT_FAILURE);
+	}
+	fonts_loaded_ns = now_monotonic_ns() - fonts_loaded_ns;
+
+	struct cairo_swbuf_t *swbuf = create_swbuf(width, height, bits_per_pixel);
+	if (!swbuf) {
+		fprintf(stderr, "Could not create %u x %u software buffer at %u bpp.\n", width, height, bits_per_pixel);
+		exit(EXIT_FAILURE);
+	}
+
+	/* The very first frame pays for font matching and cold caches */
+	struct render_state_t first_state;
+	generate_state(&first_state, SCENARIO_MAIN);
+	swbuf_render_full_hd(&first_state, swbuf);
+	printf("First frame rendered %.1f ms after startup (%s fontconfig, %.1f ms loading fonts)\n", (now_monotonic_ns() - startup_ns) / 1e6, private_fontconfig ? "private" : "system", fonts_loaded_ns / 1e6);
+
+	printf("Rendering at %u x %u, %u bpp\n", width, height, bits_per_pixel);
+	unsigned int first_threads = scaling_benchmark ? 1 : tiled_threads;
+	unsigned int last_threads = scaling_benchmark ? SCALING_MAX_THREADS : tiled_threads;
+	for (unsigned int threads = first_threads; threads <= last_threads; threads++) {
+		if (!renderer_full_hd_set_tiled(threads, tiled_tiles)) {
+			fprintf(stderr, "Could not start tiled rendering.\n");
+			exit(EXIT_FAILURE);
+		}
+		if (threads) {
+			printf("Tiled rendering: %u threads, %u bands\n", threads, tiled_tiles);
+		}
+		for (enum render_profile_t profile = first_profile; profile <= last_profile; profile++) {
+			swbuf_set_profile(swbuf, profile);
+			printf("Render profile: %s\n", render_profile_name(profile));
+			for (unsigned int i = 0; i < SCENARIO_COUNT; i++) {
+				if ((only_scenario == -1) || (only_scenario == i)) {
+					run_scenario(i, swbuf, iterations, dump_prefix);
+				}
+			}
+		}
+	}
+
+	struct fontcache_stats_t fontcache_stats;
+	fontcache_get_stats(&fontcache_stats);
+	printf("Font cache: %u fonts, %llu hits, %llu misses\n", fontcache_stats.entries, fontcache_stats.hits, fontcache_stats.misses);
+	struct textcache_stats_t textcache_stats;
+	textcache_get_stats(&textcache_stats);
+	printf("Text extents cache: %u of %u entries, %llu hits, %llu misses, %llu evictions, %llu uncacheable\n", textcache_stats.entries, TEXTCACHE_ENTRY_COUNT, textcache_stats.hits, textcache_stats.misses, textcache_stats.evictions, textcache_stats.uncacheable);
+	struct spritecache_stats_t spritecache_stats;
+	spritecache_get_stats(&spritecache_stats);
+	printf("Sprite cache: %u sprites, %u of %u kiB, %llu hits, %llu misses, %llu evictions\n", spritecache_stats.entries, spritecache_stats.size_bytes / 1024, SPRITECACHE_BUDGET_BYTES / 1024, spritecache_stats.hits, spritecache_stats.misses, spritecache_stats.evictions);
+	struct renderer_stats_t renderer_stats;
+	renderer_full_hd_get_stats(&renderer_stats);
+	printf("Static layers: %u rebuilds, %u reuses, %.1f Mpixels restored\n", renderer_stats.static_layer_rebuilds, renderer_stats.static_layer_reuses, renderer_stats.restored_pixels / 1e6);
+	printf("Layouts: %u resolutions\n", renderer_stats.layout_resolutions);
+	printf("Highscore table: %llu unchanged, %llu cells reused, %llu cells redrawn\n", renderer_stats.highscore_table.table_hits, renderer_stats.highscore_table.cell_hits, renderer_stats.highscore_table.cell_misses);
+	if (renderer_stats.recorded_ops) {
+		printf("Display list: %llu operations recorded, %llu replayed (%.1f%%)\n", renderer_stats.recorded_ops, renderer_stats.replayed_ops, 100. * renderer_stats.replayed_ops / renderer_stats.recorded_ops);
+	}
+
+	free_swbuf(swbuf);
+	renderer_full_hd_free();
+	cairo_cleanup();
+	return 0;
+}
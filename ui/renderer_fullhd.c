@@ -20,21 +20,29 @@
 	Johannes Bauer <JohannesBauer@gmx.de>
 */
 
+#include <string.h>
+#include <math.h>
+#include <pthread.h>
 #include "renderer_fullhd.h"
 #include "cyberblades-ui.h"
 #include "cairo.h"
 #include "historian.h"
 #include "cformat.h"
+#include "displaylist.h"
+#include "tilerender.h"
+#include "tablecache.h"
+#include "layout.h"
 
 #define STR_ENDASH								"–"
 #define STR_EMDASH								"—"
 
 #define FONT_HEADING_SIZE						128
-#define FONT_HEADING							.font_face = "Beon", .font_size = FONT_HEADING_SIZE
-#define TEXT_PLACEMENT(xoff, yoff, color)		&(const struct font_placement_t) {		\
+#define FONT_HEADING							.font_face = "Beon", .font_size = FONT_HEADING_SIZE, .cache_sprite = true
+#define ROBOTO_40(xoff, yoff, color, sprite)	{										\
 													.font_face = "Roboto",				\
 													.font_size = 40,					\
 													.font_color = (color),				\
+													.cache_sprite = (sprite),			\
 													.placement = {						\
 														 .src_anchor = {				\
 															.x = XPOS_CENTER,			\
@@ -48,24 +56,226 @@
 														.yoffset = (yoff),				\
 													}									\
 												}
-
-static void swbuf_render_heading(struct cairo_swbuf_t *swbuf, const char *text) {
-	swbuf_text(swbuf, &(const struct font_placement_t) {
-		FONT_HEADING,
-		.font_color = COLOR_BS_RED,
-		.placement = {
-			.src_anchor = {	.x = XPOS_CENTER, .y = YPOS_BOTTOM, },
-			.dst_anchor = { .x = XPOS_CENTER, .y = YPOS_TOP, },
-			.yoffset = FONT_HEADING_SIZE - 8,
-		}
-	}, text);
-}
-
-static void swbuf_render_main_screen_bottom_box(const struct server_state_t *server_state, struct cairo_swbuf_t *swbuf) {
+#define LAYOUT_LABEL(xoff, yoff, color, label_text)	{ .type = LAYOUT_TEXT, .label = (label_text), .text = ROBOTO_40(xoff, yoff, color, true) }
+#define LAYOUT_VALUE(xoff, yoff, color)			{ .type = LAYOUT_TEXT, .text = ROBOTO_40(xoff, yoff, color, false) }
+
+/* Columns of the player statistics on the main screen, 360 pixels apart */
+enum main_stat_column_t {
+	STAT_PLAYTIME,
+	STAT_NOTES_CUT,
+	STAT_GAMES_PLAYED,
+	STAT_TOTAL_SCORE,
+	STAT_PERCENTAGE,
+	STAT_COLUMN_COUNT,
+};
+#define STAT_COLUMN_X(column)					(360 * ((int)(column) - 2))
+
+enum main_screen_element_t {
+	MAIN_TITLE_CYBER,
+	MAIN_TITLE_BLADES,
+	MAIN_NO_PLAYER,
+	MAIN_STATUS_BOX,
+	MAIN_STATUS_TEXT,
+	MAIN_PLAYER_NAME,
+	MAIN_SONG,
+	MAIN_STAT_LABEL,
+	MAIN_STAT_TODAY = MAIN_STAT_LABEL + STAT_COLUMN_COUNT,
+	MAIN_STAT_ALLTIME = MAIN_STAT_TODAY + STAT_COLUMN_COUNT,
+	MAIN_ELEMENT_COUNT = MAIN_STAT_ALLTIME + STAT_COLUMN_COUNT,
+};
+
+#define CYBERBLADES_OFFSET						-5
+
+static const struct layout_element_t main_screen_elements[MAIN_ELEMENT_COUNT] = {
+	[MAIN_TITLE_CYBER] = {
+		.type = LAYOUT_TEXT,
+		.label = "Cyber",
+		.text = {
+			FONT_HEADING,
+			.font_color = COLOR_BS_RED,
+			.placement = {
+				.src_anchor = {	.x = XPOS_RIGHT, .y = YPOS_BOTTOM, },
+				.dst_anchor = { .x = XPOS_CENTER, .y = YPOS_TOP, },
+				.yoffset = FONT_HEADING_SIZE - 8,
+				.xoffset = -5 + CYBERBLADES_OFFSET,
+			},
+		},
+	},
+	[MAIN_TITLE_BLADES] = {
+		.type = LAYOUT_TEXT,
+		.label = "Blades",
+		.text = {
+			FONT_HEADING,
+			.font_color = COLOR_BS_BLUE,
+			.placement = {
+				.src_anchor = { .x = XPOS_LEFT, .y = YPOS_BOTTOM, },
+				.dst_anchor = { .x = XPOS_CENTER, .y = YPOS_TOP, },
+				.yoffset = FONT_HEADING_SIZE - 8,
+				.xoffset = 5 + CYBERBLADES_OFFSET,
+			},
+		},
+	},
+	[MAIN_NO_PLAYER] = LAYOUT_LABEL(0, 200 + 45 * 0, COLOR_POMEGRANATE, "No player selected"),
+	[MAIN_STATUS_BOX] = {
+		.type = LAYOUT_RECT,
+		.rect = {
+			.placement = {
+				.src_anchor = { .x = XPOS_CENTER, .y = YPOS_BOTTOM },
+				.dst_anchor = {	.x = XPOS_CENTER, .y = YPOS_BOTTOM },
+				.yoffset = -10,
+			},
+			.fill = true,
+			.round = 15,
+			.width = 1000,
+			.height = 75,
+		},
+	},
+	[MAIN_STATUS_TEXT] = LAYOUT_LABEL(0, 1045, COLOR_WHITE, NULL),
+	[MAIN_PLAYER_NAME] = {
+		.type = LAYOUT_TEXT,
+		.text = {
+			.font_face = "Roboto",
+			.font_size = 40,
+			.font_color = COLOR_CLOUDS,
+			.placement = {
+				.src_anchor = { .x = XPOS_LEFT, .y = YPOS_BOTTOM, },
+				.dst_anchor = { .x = XPOS_LEFT, .y = YPOS_TOP, },
+				.xoffset = 100,
+				.yoffset = 200,
+			},
+		},
+	},
+	[MAIN_SONG] = {
+		.type = LAYOUT_TEXT,
+		.text = {
+			.font_face = "Roboto",
+			.font_size = 40,
+			.font_color = COLOR_CLOUDS,
+			.placement = {
+				.src_anchor = { .x = XPOS_RIGHT, .y = YPOS_BOTTOM, },
+				.dst_anchor = { .x = XPOS_RIGHT, .y = YPOS_TOP, },
+				.xoffset = -100,
+				.yoffset = 200,
+			},
+		},
+	},
+	[MAIN_STAT_LABEL + STAT_PLAYTIME] = LAYOUT_LABEL(STAT_COLUMN_X(STAT_PLAYTIME), 200 + 45 * 2, COLOR_CLOUDS, "Playtime"),
+	[MAIN_STAT_LABEL + STAT_NOTES_CUT] = LAYOUT_LABEL(STAT_COLUMN_X(STAT_NOTES_CUT), 200 + 45 * 2, COLOR_CLOUDS, "Notes Cut"),
+	[MAIN_STAT_LABEL + STAT_GAMES_PLAYED] = LAYOUT_LABEL(STAT_COLUMN_X(STAT_GAMES_PLAYED), 200 + 45 * 2, COLOR_CLOUDS, "Games Played"),
+	[MAIN_STAT_LABEL + STAT_TOTAL_SCORE] = LAYOUT_LABEL(STAT_COLUMN_X(STAT_TOTAL_SCORE), 200 + 45 * 2, COLOR_CLOUDS, "Total Score"),
+	[MAIN_STAT_LABEL + STAT_PERCENTAGE] = LAYOUT_LABEL(STAT_COLUMN_X(STAT_PERCENTAGE), 200 + 45 * 2, COLOR_CLOUDS, "Percentage"),
+	[MAIN_STAT_TODAY + STAT_PLAYTIME] = LAYOUT_VALUE(STAT_COLUMN_X(STAT_PLAYTIME), 200 + 45 * 3, COLOR_CLOUDS),
+	[MAIN_STAT_TODAY + STAT_NOTES_CUT] = LAYOUT_VALUE(STAT_COLUMN_X(STAT_NOTES_CUT), 200 + 45 * 3, COLOR_CLOUDS),
+	[MAIN_STAT_TODAY + STAT_GAMES_PLAYED] = LAYOUT_VALUE(STAT_COLUMN_X(STAT_GAMES_PLAYED), 200 + 45 * 3, COLOR_CLOUDS),
+	[MAIN_STAT_TODAY + STAT_TOTAL_SCORE] = LAYOUT_VALUE(STAT_COLUMN_X(STAT_TOTAL_SCORE), 200 + 45 * 3, COLOR_CLOUDS),
+	[MAIN_STAT_TODAY + STAT_PERCENTAGE] = LAYOUT_VALUE(STAT_COLUMN_X(STAT_PERCENTAGE), 200 + 45 * 3, COLOR_CLOUDS),
+	[MAIN_STAT_ALLTIME + STAT_PLAYTIME] = LAYOUT_VALUE(STAT_COLUMN_X(STAT_PLAYTIME), 200 + 45 * 4, COLOR_CLOUDS),
+	[MAIN_STAT_ALLTIME + STAT_NOTES_CUT] = LAYOUT_VALUE(STAT_COLUMN_X(STAT_NOTES_CUT), 200 + 45 * 4, COLOR_CLOUDS),
+	[MAIN_STAT_ALLTIME + STAT_GAMES_PLAYED] = LAYOUT_VALUE(STAT_COLUMN_X(STAT_GAMES_PLAYED), 200 + 45 * 4, COLOR_CLOUDS),
+	[MAIN_STAT_ALLTIME + STAT_TOTAL_SCORE] = LAYOUT_VALUE(STAT_COLUMN_X(STAT_TOTAL_SCORE), 200 + 45 * 4, COLOR_CLOUDS),
+	[MAIN_STAT_ALLTIME + STAT_PERCENTAGE] = LAYOUT_VALUE(STAT_COLUMN_X(STAT_PERCENTAGE), 200 + 45 * 4, COLOR_CLOUDS),
+};
+
+/* Counters on the game screen, 360 pixels apart */
+enum game_counter_t {
+	COUNTER_COMBO,
+	COUNTER_MISSED_NOTES,
+	COUNTER_TOTAL_NOTES,
+	COUNTER_NOTE_PERCENTAGE,
+	COUNTER_MAX_COMBO,
+	GAME_COUNTER_COUNT,
+};
+#define COUNTER_X(counter)						(360 * ((int)(counter) - 2))
+
+enum game_screen_element_t {
+	GAME_HEADING,
+	GAME_SCORE,
+	GAME_PERCENTAGE,
+	GAME_RANK,
+	GAME_COUNTER_LABEL,
+	GAME_COUNTER = GAME_COUNTER_LABEL + GAME_COUNTER_COUNT,
+	GAME_ELEMENT_COUNT = GAME_COUNTER + GAME_COUNTER_COUNT,
+};
+
+static const struct layout_element_t game_screen_elements[GAME_ELEMENT_COUNT] = {
+	[GAME_HEADING] = {
+		.type = LAYOUT_TEXT,
+		.label = "Game On",
+		.text = {
+			FONT_HEADING,
+			.font_color = COLOR_BS_RED,
+			.placement = {
+				.src_anchor = {	.x = XPOS_CENTER, .y = YPOS_BOTTOM, },
+				.dst_anchor = { .x = XPOS_CENTER, .y = YPOS_TOP, },
+				.yoffset = FONT_HEADING_SIZE - 8,
+			},
+		},
+	},
+	[GAME_SCORE] = {
+		.type = LAYOUT_TEXT,
+		.text = {
+			.font_face = "Instruction",
+			.font_size = 140,
+			.font_color = COLOR_SUN_FLOWER,
+			.placement = {
+				.src_anchor = { .x = XPOS_CENTER, .y = YPOS_BOTTOM, },
+				.dst_anchor = { .x = XPOS_CENTER, .y = YPOS_TOP, },
+				.yoffset = 200 + 96,
+			},
+		},
+	},
+	[GAME_PERCENTAGE] = {
+		.type = LAYOUT_TEXT,
+		.text = {
+			.font_face = "Roboto",
+			.font_size = 80,
+			.font_color = COLOR_ORANGE,
+			.placement = {
+				.src_anchor = { .x = XPOS_CENTER, .y = YPOS_BOTTOM, },
+				.dst_anchor = { .x = XPOS_CENTER, .y = YPOS_TOP, },
+				.xoffset = 10 - 200,
+				.yoffset = 200 + 96 + 96,
+			},
+		},
+	},
+	[GAME_RANK] = {
+		.type = LAYOUT_TEXT,
+		.text = {
+			.font_face = "Roboto",
+			.font_size = 80,
+			.font_color = COLOR_ORANGE,
+			.placement = {
+				.src_anchor = { .x = XPOS_CENTER, .y = YPOS_BOTTOM, },
+				.dst_anchor = { .x = XPOS_CENTER, .y = YPOS_TOP, },
+				.xoffset = 10 + 200,
+				.yoffset = 200 + 96 + 96,
+			},
+		},
+	},
+	[GAME_COUNTER_LABEL + COUNTER_COMBO] = LAYOUT_LABEL(COUNTER_X(COUNTER_COMBO), 500, COLOR_CLOUDS, "Combo"),
+	[GAME_COUNTER_LABEL + COUNTER_MISSED_NOTES] = LAYOUT_LABEL(COUNTER_X(COUNTER_MISSED_NOTES), 500, COLOR_CLOUDS, "Missed Notes"),
+	[GAME_COUNTER_LABEL + COUNTER_TOTAL_NOTES] = LAYOUT_LABEL(COUNTER_X(COUNTER_TOTAL_NOTES), 500, COLOR_CLOUDS, "Total Notes"),
+	[GAME_COUNTER_LABEL + COUNTER_NOTE_PERCENTAGE] = LAYOUT_LABEL(COUNTER_X(COUNTER_NOTE_PERCENTAGE), 500, COLOR_CLOUDS, "Note Percentage"),
+	[GAME_COUNTER_LABEL + COUNTER_MAX_COMBO] = LAYOUT_LABEL(COUNTER_X(COUNTER_MAX_COMBO), 500, COLOR_CLOUDS, "Max Combo"),
+	[GAME_COUNTER + COUNTER_COMBO] = LAYOUT_VALUE(COUNTER_X(COUNTER_COMBO), 500 + 40, COLOR_CLOUDS),
+	[GAME_COUNTER + COUNTER_MISSED_NOTES] = LAYOUT_VALUE(COUNTER_X(COUNTER_MISSED_NOTES), 500 + 40, COLOR_CLOUDS),
+	[GAME_COUNTER + COUNTER_TOTAL_NOTES] = LAYOUT_VALUE(COUNTER_X(COUNTER_TOTAL_NOTES), 500 + 40, COLOR_CLOUDS),
+	[GAME_COUNTER + COUNTER_NOTE_PERCENTAGE] = LAYOUT_VALUE(COUNTER_X(COUNTER_NOTE_PERCENTAGE), 500 + 40, COLOR_CLOUDS),
+	[GAME_COUNTER + COUNTER_MAX_COMBO] = LAYOUT_VALUE(COUNTER_X(COUNTER_MAX_COMBO), 500 + 40, COLOR_CLOUDS),
+};
+
+/* Owned by the render thread */
+static struct tablecache_t *highscore_table_cache;
+static union layout_resolved_t main_screen_resolved[MAIN_ELEMENT_COUNT];
+static struct layout_t main_screen_layout = LAYOUT_INITIALIZER(main_screen_elements, main_screen_resolved);
+static union layout_resolved_t game_screen_resolved[GAME_ELEMENT_COUNT];
+static struct layout_t game_screen_layout = LAYOUT_INITIALIZER(game_screen_elements, game_screen_resolved);
+
+static void swbuf_render_main_screen_bottom_box(const struct render_state_t *state, struct cairo_swbuf_t *swbuf) {
 	uint32_t fgcolor, bgcolor;
 	const char *text = NULL;
 
-	switch (server_state->historian->connection_state) {
+	switch (state->historian_state) {
 		case UNCONNECTED:
 			fgcolor = COLOR_WHITE;
 			bgcolor = COLOR_POMEGRANATE;
@@ -73,7 +283,7 @@ static void swbuf_render_main_screen_bottom_box(const struct server_state_t *ser
 			break;
 
 		case CONNECTED:
-			if (!server_state->connected_to_beatsaber) {
+			if (!state->connected_to_beatsaber) {
 				fgcolor = COLOR_BLACK;
 				bgcolor = COLOR_SUN_FLOWER;
 				text = "Not connected to BeatSaber";
@@ -86,19 +296,8 @@ static void swbuf_render_main_screen_bottom_box(const struct server_state_t *ser
 	}
 
 	if (text) {
-		swbuf_rect(swbuf, &(const struct rect_placement_t){
-			.placement = {
-				.src_anchor = { .x = XPOS_CENTER, .y = YPOS_BOTTOM },
-				.dst_anchor = {	.x = XPOS_CENTER, .y = YPOS_BOTTOM },
-				.yoffset = -10,
-			},
-			.color = bgcolor,
-			.fill = true,
-			.round = 15,
-			.width = 1000,
-			.height = 75,
-		});
-		swbuf_text(swbuf, TEXT_PLACEMENT(0, 1045, fgcolor), text);
+		layout_rect(&main_screen_layout, swbuf, MAIN_STATUS_BOX, bgcolor);
+		layout_text(&main_screen_layout, swbuf, MAIN_STATUS_TEXT, fgcolor, "%s", text);
 	}
 }
 
@@ -143,7 +342,7 @@ static void render_highscore_table_entry(char *dest_buf, unsigned int dest_buf_l
 }
 
 static void render_highscore_table(char *dest_buf, unsigned int dest_buf_length, struct font_placement_t *placement, unsigned int x, unsigned int y, void *ctx) {
-	const struct server_state_t *server_state = (const struct server_state_t*)ctx;
+	const struct render_state_t *state = (const struct render_state_t*)ctx;
 
 	if (y == 0) {
 		const char *column_headings[] = {
@@ -165,11 +364,11 @@ static void render_highscore_table(char *dest_buf, unsigned int dest_buf_length,
 	}
 
 	const unsigned int highscore_index = y - 1;
-	if (highscore_index >= server_state->highscores.entry_count) {
+	if (highscore_index >= state->highscores.entry_count) {
 		return;
 	}
 
-	const struct highscore_entry_t *highscore_entry = &server_state->highscores.entries[highscore_index];
+	const struct highscore_entry_t *highscore_entry = &state->highscores.entries[highscore_index];
 
 	if (!highscore_entry->performance.verdict_passed) {
 		placement->font_color = COLOR_ASBESTOS;
@@ -192,103 +391,50 @@ static const char *difficulty_str(enum difficulty_level_t difficulty) {
 	return "?";
 }
 
-static void swbuf_render_main_screen(const struct server_state_t *server_state, struct cairo_swbuf_t *swbuf) {
-	const int cyberblades_offset = -5;
-	swbuf_text(swbuf, &(const struct font_placement_t) {
-		FONT_HEADING,
-		.font_color = COLOR_BS_RED,
-		.placement = {
-			.src_anchor = {	.x = XPOS_RIGHT, .y = YPOS_BOTTOM, },
-			.dst_anchor = { .x = XPOS_CENTER, .y = YPOS_TOP, },
-			.yoffset = FONT_HEADING_SIZE - 8,
-			.xoffset = -5 + cyberblades_offset,
-		}
-	}, "Cyber");
-	swbuf_text(swbuf, &(const struct font_placement_t) {
-		FONT_HEADING,
-		.font_color = COLOR_BS_BLUE,
-		.placement = {
-			.src_anchor = { .x = XPOS_LEFT, .y = YPOS_BOTTOM, },
-			.dst_anchor = { .x = XPOS_CENTER, .y = YPOS_TOP, },
-			.yoffset = FONT_HEADING_SIZE - 8,
-			.xoffset = 5 + cyberblades_offset,
+static void swbuf_render_main_screen_static(const struct render_state_t *state, struct cairo_swbuf_t *swbuf) {
+	layout_draw(&main_screen_layout, swbuf, MAIN_TITLE_CYBER);
+	layout_draw(&main_screen_layout, swbuf, MAIN_TITLE_BLADES);
+
+	if (state->player.name[0]) {
+		for (unsigned int i = 0; i < STAT_COLUMN_COUNT; i++) {
+			layout_draw(&main_screen_layout, swbuf, MAIN_STAT_LABEL + i);
 		}
-	}, "Blades");
+	} else {
+		layout_draw(&main_screen_layout, swbuf, MAIN_NO_PLAYER);
+	}
 
-	if (server_state->player.name[0]) {
-		const struct font_placement_t player_placement = {
-			.font_face = "Roboto",
-			.font_size = 40,
-			.font_color = COLOR_CLOUDS,
-			.placement = {
-				 .src_anchor = {
-					.x = XPOS_LEFT,
-					.y = YPOS_BOTTOM,
-				},
-				.dst_anchor = {
-					.x = XPOS_LEFT,
-					.y = YPOS_TOP,
-				},
-				.xoffset = 100,
-				.yoffset = 200,
-			}
-		};
-		swbuf_text(swbuf, &player_placement, "%s", server_state->player.name);
+	swbuf_render_main_screen_bottom_box(state, swbuf);
+}
 
+static void swbuf_render_player_stats(struct cairo_swbuf_t *swbuf, unsigned int first_element, const struct player_stats_t *stats) {
+	layout_text(&main_screen_layout, swbuf, first_element + STAT_PLAYTIME, COLOR_CLOUDS, "%s", cformat_sbuf_time_secs(stats->total_playtime_secs));
+	layout_text(&main_screen_layout, swbuf, first_element + STAT_NOTES_CUT, COLOR_CLOUDS, "%s", cformat_sbuf_si_float((double)(stats->total_passed_notes - stats->total_missed_notes)));
+	layout_text(&main_screen_layout, swbuf, first_element + STAT_GAMES_PLAYED, COLOR_CLOUDS, "%u", stats->games_played);
+	layout_text(&main_screen_layout, swbuf, first_element + STAT_TOTAL_SCORE, COLOR_CLOUDS, "%s", cformat_sbuf_si_float((double)stats->total_score));
+	if (stats->total_max_score) {
+		layout_text(&main_screen_layout, swbuf, first_element + STAT_PERCENTAGE, COLOR_CLOUDS, "%.1f%%", 100. * stats->total_score / stats->total_max_score);
+	} else {
+		layout_text(&main_screen_layout, swbuf, first_element + STAT_PERCENTAGE, COLOR_CLOUDS, STR_EMDASH);
+	}
+}
 
-		const struct font_placement_t song_placement = {
-			.font_face = "Roboto",
-			.font_size = 40,
-			.font_color = COLOR_CLOUDS,
-			.placement = {
-				 .src_anchor = {
-					.x = XPOS_RIGHT,
-					.y = YPOS_BOTTOM,
-				},
-				.dst_anchor = {
-					.x = XPOS_RIGHT,
-					.y = YPOS_TOP,
-				},
-				.xoffset = -100,
-				.yoffset = 200,
-			}
-		};
-		if (server_state->highscores.song_key.song_title[0]) {
-			if (server_state->highscores.song_key.song_author[0]) {
-				swbuf_text(swbuf, &song_placement, "%s - %s (%s)", server_state->highscores.song_key.song_author, server_state->highscores.song_key.song_title, difficulty_str(server_state->highscores.song_key.difficulty));
+static void swbuf_render_main_screen_dynamic(const struct render_state_t *state, struct cairo_swbuf_t *swbuf) {
+	if (state->player.name[0]) {
+		layout_text(&main_screen_layout, swbuf, MAIN_PLAYER_NAME, COLOR_CLOUDS, "%s", state->player.name);
+
+		if (state->highscores.song_key.song_title[0]) {
+			if (state->highscores.song_key.song_author[0]) {
+				layout_text(&main_screen_layout, swbuf, MAIN_SONG, COLOR_CLOUDS, "%s - %s (%s)", state->highscores.song_key.song_author, state->highscores.song_key.song_title, difficulty_str(state->highscores.song_key.difficulty));
 			} else {
-				swbuf_text(swbuf, &song_placement, "%s (%s)", server_state->highscores.song_key.song_title, difficulty_str(server_state->highscores.song_key.difficulty));
+				layout_text(&main_screen_layout, swbuf, MAIN_SONG, COLOR_CLOUDS, "%s (%s)", state->highscores.song_key.song_title, difficulty_str(state->highscores.song_key.difficulty));
 			}
 		}
 
-		swbuf_text(swbuf, TEXT_PLACEMENT(-360 * 2, 200 + 45 * 2, COLOR_CLOUDS), "Playtime");
-		swbuf_text(swbuf, TEXT_PLACEMENT(-360 * 1, 200 + 45 * 2, COLOR_CLOUDS), "Notes Cut");
-		swbuf_text(swbuf, TEXT_PLACEMENT(0, 200 + 45 * 2, COLOR_CLOUDS), "Games Played");
-		swbuf_text(swbuf, TEXT_PLACEMENT(360 * 1, 200 + 45 * 2, COLOR_CLOUDS), "Total Score");
-		swbuf_text(swbuf, TEXT_PLACEMENT(360 * 2, 200 + 45 * 2, COLOR_CLOUDS), "Percentage");
-
-		swbuf_text(swbuf, TEXT_PLACEMENT(-360 * 2, 200 + 45 * 3, COLOR_CLOUDS), "%s", cformat_sbuf_time_secs(server_state->player.today.total_playtime_secs));
-		swbuf_text(swbuf, TEXT_PLACEMENT(-360 * 1, 200 + 45 * 3, COLOR_CLOUDS), "%s", cformat_sbuf_si_float((double)(server_state->player.today.total_passed_notes - server_state->player.today.total_missed_notes)));
-		swbuf_text(swbuf, TEXT_PLACEMENT(0, 200 + 45 * 3, COLOR_CLOUDS), "%u", server_state->player.today.games_played);
-		swbuf_text(swbuf, TEXT_PLACEMENT(360 * 1, 200 + 45 * 3, COLOR_CLOUDS), "%s", cformat_sbuf_si_float((double)server_state->player.today.total_score));
-		if (server_state->player.today.total_max_score) {
-			swbuf_text(swbuf, TEXT_PLACEMENT(360 * 2, 200 + 45 * 3, COLOR_CLOUDS), "%.1f%%", 100. * server_state->player.today.total_score / server_state->player.today.total_max_score);
-		} else {
-			swbuf_text(swbuf, TEXT_PLACEMENT(360 * 2, 200 + 45 * 3, COLOR_CLOUDS), STR_EMDASH);
-		}
-
-		swbuf_text(swbuf, TEXT_PLACEMENT(-360 * 2, 200 + 45 * 4, COLOR_CLOUDS), "%s", cformat_sbuf_time_secs(server_state->player.alltime.total_playtime_secs));
-		swbuf_text(swbuf, TEXT_PLACEMENT(-360 * 1, 200 + 45 * 4, COLOR_CLOUDS), "%s", cformat_sbuf_si_float((double)(server_state->player.alltime.total_passed_notes - server_state->player.alltime.total_missed_notes)));
-		swbuf_text(swbuf, TEXT_PLACEMENT(0, 200 + 45 * 4, COLOR_CLOUDS), "%u", server_state->player.alltime.games_played);
-		swbuf_text(swbuf, TEXT_PLACEMENT(360 * 1, 200 + 45 * 4, COLOR_CLOUDS), "%s", cformat_sbuf_si_float((double)server_state->player.alltime.total_score));
-		if (server_state->player.alltime.total_max_score) {
-			swbuf_text(swbuf, TEXT_PLACEMENT(360 * 2, 200 + 45 * 4, COLOR_CLOUDS), "%.1f%%", 100. * server_state->player.alltime.total_score / server_state->player.alltime.total_max_score);
-		} else {
-			swbuf_text(swbuf, TEXT_PLACEMENT(360 * 2, 200 + 45 * 4, COLOR_CLOUDS), STR_EMDASH);
-		}
+		swbuf_render_player_stats(swbuf, MAIN_STAT_TODAY, &state->player.today);
+		swbuf_render_player_stats(swbuf, MAIN_STAT_ALLTIME, &state->player.alltime);
 
 		const struct table_definition_t table = {
-			.rows = 1 + server_state->highscores.entry_count,
+			.rows = 1 + state->highscores.entry_count,
 			.columns = 8,
 			.row_height = 45,
 			.column_widths = (unsigned int[]) { 100, 250, 200, 150, 150, 150, 150, 100 },
@@ -310,101 +456,293 @@ static void swbuf_render_main_screen(const struct server_state_t *server_state,
 				.font_size = 40,
 				.font_color = COLOR_CLOUDS,
 			},
+			.cache = highscore_table_cache,
+			.version = state->highscores.version,
 		};
-		swbuf_render_table(swbuf, &table, (void*)server_state);
-	} else {
-		swbuf_text(swbuf, TEXT_PLACEMENT(0, 200 + 45 * 0, COLOR_POMEGRANATE), "No player selected");
+		swbuf_render_table(swbuf, &table, (void*)state);
 	}
+}
 
-	swbuf_render_main_screen_bottom_box(server_state, swbuf);
+static void swbuf_render_game_screen_static(const struct render_state_t *state, struct cairo_swbuf_t *swbuf) {
+	layout_draw(&game_screen_layout, swbuf, GAME_HEADING);
+	for (unsigned int i = 0; i < GAME_COUNTER_COUNT; i++) {
+		layout_draw(&game_screen_layout, swbuf, GAME_COUNTER_LABEL + i);
+	}
 }
 
-static void swbuf_render_game_screen(const struct server_state_t *server_state, struct cairo_swbuf_t *swbuf) {
-	static unsigned int last_score_width = 0;
-	swbuf_render_heading(swbuf, "Game On");
-	last_score_width = swbuf_text(swbuf, &(const struct font_placement_t){
-		.font_face = "Instruction",
-		.font_size = 140,
-		.font_color = COLOR_SUN_FLOWER,
-		.last_width = last_score_width,
-		.max_width_deviation = 10,
-		.placement = {
-			.src_anchor = {
-				.x = XPOS_CENTER,
-				.y = YPOS_BOTTOM,
-			},
-			.dst_anchor = {
-				.x = XPOS_CENTER,
-				.y = YPOS_TOP,
-			},
-			.yoffset = 200 + 96,
+/* Fixed point percentage with one decimal */
+static long percentage_tenths(unsigned int value, unsigned int total) {
+	return total ? lround(1000. * value / total) : 0;
+}
+
+static void swbuf_render_game_screen_dynamic(const struct render_state_t *state, struct cairo_swbuf_t *swbuf) {
+	const struct performance_info_t *performance = &state->current_song.performance;
+	layout_number(&game_screen_layout, swbuf, GAME_SCORE, COLOR_SUN_FLOWER, performance->score, 0, false);
+	layout_number(&game_screen_layout, swbuf, GAME_PERCENTAGE, COLOR_ORANGE, percentage_tenths(performance->score, performance->max_score), 1, true);
+	layout_text(&game_screen_layout, swbuf, GAME_RANK, COLOR_ORANGE, "%s", performance->rank[0] ? performance->rank : STR_EMDASH);
+
+	layout_number(&game_screen_layout, swbuf, GAME_COUNTER + COUNTER_COMBO, (performance->combo != performance->max_combo) ? COLOR_CLOUDS : COLOR_EMERLAND, performance->combo, 0, false);
+	layout_number(&game_screen_layout, swbuf, GAME_COUNTER + COUNTER_MISSED_NOTES, performance->missed_notes ? COLOR_POMEGRANATE : COLOR_EMERLAND, performance->missed_notes, 0, false);
+	layout_number(&game_screen_layout, swbuf, GAME_COUNTER + COUNTER_TOTAL_NOTES, COLOR_CLOUDS, performance->passed_notes, 0, false);
+	layout_number(&game_screen_layout, swbuf, GAME_COUNTER + COUNTER_NOTE_PERCENTAGE, COLOR_CLOUDS, percentage_tenths(performance->passed_notes - performance->missed_notes, performance->passed_notes), 1, true);
+	layout_number(&game_screen_layout, swbuf, GAME_COUNTER + COUNTER_MAX_COMBO, COLOR_CLOUDS, performance->max_combo, 0, false);
+}
+
+/* Everything that only depends on these inputs is rendered into a static
+ * layer once and copied into every frame; the dynamic content is drawn on top
+ * of it. Each static layer version has a unique serial. A buffer that already
+ * holds the same static layer version only needs the areas restored that
+ * were covered by dynamic content, which is what the buffer's damage list
+ * records. */
+struct static_layer_key_t {
+	enum ui_screen_t ui_screen;
+	unsigned int width, height;
+	unsigned int bits_per_pixel;
+	enum render_profile_t profile;
+	enum historian_state_t historian_state;
+	bool connected_to_beatsaber;
+	bool player_selected;
+};
+
+struct static_layer_t {
+	bool valid;
+	unsigned int serial;
+	struct static_layer_key_t key;
+	struct cairo_swbuf_t *swbuf;
+};
+
+static pthread_mutex_t static_layer_mutex = PTHREAD_MUTEX_INITIALIZER;
+static struct static_layer_t static_layers[UI_SCREEN_COUNT];
+static unsigned int static_layer_serial;
+static struct renderer_stats_t renderer_stats;
+static bool renderer_retained;
+static struct tilerender_t *tiled_renderer;
+
+static void static_layer_get_key(const struct render_state_t *state, const struct cairo_swbuf_t *swbuf, struct static_layer_key_t *key) {
+	memset(key, 0, sizeof(*key));
+	key->ui_screen = state->ui_screen;
+	key->width = swbuf->width;
+	key->height = swbuf->height;
+	key->bits_per_pixel = swbuf->bits_per_pixel;
+	key->profile = swbuf->profile;
+	if (state->ui_screen == MAIN_SCREEN) {
+		key->historian_state = state->historian_state;
+		key->connected_to_beatsaber = state->connected_to_beatsaber;
+		key->player_selected = (state->player.name[0] != 0);
+	}
+}
+
+static void swbuf_render_static_layer(const struct render_state_t *state, struct cairo_swbuf_t *swbuf) {
+	swbuf_clear(swbuf, COLOR_BS_DARKBLUE);
+	if (state->ui_screen == MAIN_SCREEN) {
+		swbuf_render_main_screen_static(state, swbuf);
+	} else if (state->ui_screen == GAME_SCREEN) {
+		swbuf_render_game_screen_static(state, swbuf);
+	}
+}
+
+/* Restores the static layer within the given region. If the buffer does not
+ * contain the current version of the static layer at all, it is copied
+ * entirely and the region is extended to the full buffer. */
+static void swbuf_restore_static_layer(const struct render_state_t *state, struct cairo_swbuf_t *swbuf, struct damage_t *region) {
+	struct static_layer_key_t key;
+	static_layer_get_key(state, swbuf, &key);
+
+	pthread_mutex_lock(&static_layer_mutex);
+	struct static_layer_t *layer = &static_layers[state->ui_screen];
+	if (!layer->valid || memcmp(&layer->key, &key, sizeof(key))) {
+		if (layer->swbuf && ((layer->swbuf->width != swbuf->width) || (layer->swbuf->height != swbuf->height) || (layer->swbuf->bits_per_pixel != swbuf->bits_per_pixel))) {
+			free_swbuf(layer->swbuf);
+			layer->swbuf = NULL;
 		}
-	}, "%ld", server_state->current_song.performance.score);
-
-	static unsigned int last_percentage_width = 0;
-	last_percentage_width = swbuf_text(swbuf, &(const struct font_placement_t){
-		.font_face = "Roboto",
-		.font_size = 80,
-		.font_color = COLOR_ORANGE,
-		.last_width = last_percentage_width,
-		.max_width_deviation = 10,
-		.placement = {
-			.src_anchor = {
-				.x = XPOS_CENTER,
-				.y = YPOS_BOTTOM,
-			},
-			.dst_anchor = {
-				.x = XPOS_CENTER,
-				.y = YPOS_TOP,
-			},
-			.xoffset = 10 - 200,
-			.yoffset = 200 + 96 + 96,
+		if (!layer->swbuf) {
+			layer->swbuf = create_swbuf(swbuf->width, swbuf->height, swbuf->bits_per_pixel);
 		}
-	}, "%.1f%%", server_state->current_song.performance.max_score ? 100. * server_state->current_song.performance.score / server_state->current_song.performance.max_score : 0);
-
-	swbuf_text(swbuf, &(const struct font_placement_t){
-		.font_face = "Roboto",
-		.font_size = 80,
-		.font_color = COLOR_ORANGE,
-		.last_width = last_percentage_width,
-		.max_width_deviation = 10,
-		.placement = {
-			.src_anchor = {
-				.x = XPOS_CENTER,
-				.y = YPOS_BOTTOM,
-			},
-			.dst_anchor = {
-				.x = XPOS_CENTER,
-				.y = YPOS_TOP,
-			},
-			.xoffset = 10 + 200,
-			.yoffset = 200 + 96 + 96,
+		if (!layer->swbuf) {
+			/* Cannot cache, render directly into the frame */
+			layer->valid = false;
+			pthread_mutex_unlock(&static_layer_mutex);
+			swbuf_render_static_layer(state, swbuf);
+			swbuf->base_layer_serial = 0;
+			damage_set_full(region);
+			return;
+		}
+		if (layer->swbuf->profile != swbuf->profile) {
+			swbuf_set_profile(layer->swbuf, swbuf->profile);
 		}
-	}, "%s", server_state->current_song.performance.rank[0] ? server_state->current_song.performance.rank : STR_EMDASH);
+		swbuf_render_static_layer(state, layer->swbuf);
+		layer->key = key;
+		layer->valid = true;
+		layer->serial = ++static_layer_serial;
+		renderer_stats.static_layer_rebuilds++;
+	} else {
+		renderer_stats.static_layer_reuses++;
+	}
 
-	swbuf_text(swbuf, TEXT_PLACEMENT(-360 * 2, 500, COLOR_CLOUDS), "Combo");
-	swbuf_text(swbuf, TEXT_PLACEMENT(-360 * 2, 500 + 40, (server_state->current_song.performance.combo != server_state->current_song.performance.max_combo) ? COLOR_CLOUDS : COLOR_EMERLAND), "%d", server_state->current_song.performance.combo);
+	if (swbuf->base_layer_serial == layer->serial) {
+		for (unsigned int i = 0; i < region->count; i++) {
+			swbuf_copy_rect(swbuf, layer->swbuf, &region->rects[i]);
+		}
+		renderer_stats.restored_pixels += damage_pixel_count(region);
+	} else {
+		swbuf_copy(swbuf, layer->swbuf);
+		swbuf->base_layer_serial = layer->serial;
+		damage_set_full(region);
+		renderer_stats.restored_pixels += swbuf->width * swbuf->height;
+	}
+	pthread_mutex_unlock(&static_layer_mutex);
+}
+
+static void swbuf_render_dynamic(const struct render_state_t *state, struct cairo_swbuf_t *swbuf) {
+	if (state->ui_screen == MAIN_SCREEN) {
+		swbuf_render_main_screen_dynamic(state, swbuf);
+	} else if (state->ui_screen == GAME_SCREEN) {
+		swbuf_render_game_screen_dynamic(state, swbuf);
+	}
+}
 
-	swbuf_text(swbuf, TEXT_PLACEMENT(-360, 500, COLOR_CLOUDS), "Missed Notes");
-	swbuf_text(swbuf, TEXT_PLACEMENT(-360, 500 + 40, server_state->current_song.performance.missed_notes ? COLOR_POMEGRANATE : COLOR_EMERLAND), "%d", server_state->current_song.performance.missed_notes);
+/* Immediate mode: undo everything that was drawn on top of the static layer
+ * and draw all dynamic content again */
+static void swbuf_render_immediate(const struct render_state_t *state, struct cairo_swbuf_t *swbuf) {
+	struct damage_t restore = swbuf->damage;
+	swbuf_restore_static_layer(state, swbuf, &restore);
+	damage_reset(&swbuf->damage);
+	if (swbuf->displaylist) {
+		displaylist_invalidate(swbuf->displaylist);
+	}
+	swbuf_render_dynamic(state, swbuf);
+}
 
-	swbuf_text(swbuf, TEXT_PLACEMENT(0, 500, COLOR_CLOUDS), "Total Notes");
-	swbuf_text(swbuf, TEXT_PLACEMENT(0, 500 + 40, COLOR_CLOUDS), "%d", server_state->current_song.performance.passed_notes);
+/* Records the dynamic content and draws it from the display list. In
+ * retained (incremental) mode, only the areas in which operations differ from
+ * what the buffer already contains are redrawn. */
+static void swbuf_render_recorded(const struct render_state_t *state, struct cairo_swbuf_t *swbuf, bool incremental) {
+	if (!swbuf->displaylist) {
+		swbuf->displaylist = displaylist_create();
+		if (!swbuf->displaylist) {
+			swbuf_render_immediate(state, swbuf);
+			return;
+		}
+	}
 
-	swbuf_text(swbuf, TEXT_PLACEMENT(360, 500, COLOR_CLOUDS), "Note Percentage");
-	swbuf_text(swbuf, TEXT_PLACEMENT(360, 500 + 40, COLOR_CLOUDS), "%.1f%%", server_state->current_song.performance.passed_notes ? 100. * (server_state->current_song.performance.passed_notes - server_state->current_song.performance.missed_notes) / server_state->current_song.performance.passed_notes : 0);
+	struct displaylist_t *displaylist = swbuf->displaylist;
+	displaylist_begin(displaylist);
+	swbuf_render_dynamic(state, swbuf);
+	displaylist_end(displaylist);
 
-	swbuf_text(swbuf, TEXT_PLACEMENT(360 * 2, 500, COLOR_CLOUDS), "Max Combo");
-	swbuf_text(swbuf, TEXT_PLACEMENT(360 * 2, 500 + 40, COLOR_CLOUDS), "%d", server_state->current_song.performance.max_combo);
+	struct damage_t redraw;
+	if (incremental && displaylist->previous_valid) {
+		damage_init(&redraw, swbuf->width, swbuf->height);
+		displaylist_diff(displaylist, &redraw);
+		swbuf_restore_static_layer(state, swbuf, &redraw);
+	} else {
+		/* Wipe what the previous frame drew, then draw everything */
+		redraw = swbuf->damage;
+		swbuf_restore_static_layer(state, swbuf, &redraw);
+		damage_set_full(&redraw);
+	}
+
+	unsigned int replayed;
+	if (tiled_renderer) {
+		replayed = tilerender_replay(tiled_renderer, displaylist, swbuf, &redraw);
+	} else {
+		replayed = displaylist_replay(displaylist, swbuf, &redraw);
+	}
+
+	/* For presentation, the damage describes everything on top of the
+	 * static layer */
+	damage_reset(&swbuf->damage);
+	displaylist_get_coverage(displaylist, &swbuf->damage);
+
+	pthread_mutex_lock(&static_layer_mutex);
+	renderer_stats.recorded_ops += displaylist->frames[displaylist->current].count;
+	renderer_stats.replayed_ops += replayed;
+	pthread_mutex_unlock(&static_layer_mutex);
 }
 
-void swbuf_render_full_hd(const struct server_state_t *server_state, struct cairo_swbuf_t *swbuf) {
-	swbuf_clear(swbuf, COLOR_BS_DARKBLUE);
-	if (server_state->ui_screen == MAIN_SCREEN) {
-		swbuf_render_main_screen(server_state, swbuf);
-	} if (server_state->ui_screen == GAME_SCREEN) {
-		swbuf_render_game_screen(server_state, swbuf);
+void swbuf_render_full_hd(const struct render_state_t *state, struct cairo_swbuf_t *swbuf) {
+	if (!highscore_table_cache) {
+		highscore_table_cache = tablecache_create();
+	}
+	if (renderer_retained || tiled_renderer) {
+		swbuf_render_recorded(state, swbuf, renderer_retained);
+	} else {
+		swbuf_render_immediate(state, swbuf);
+	}
+}
+
+/* Renders every screen once, ending with the one the state shows, so that
+ * fonts, sprites and static layers are ready before the first frame that is
+ * actually displayed */
+void renderer_full_hd_warm_up(const struct render_state_t *state, struct cairo_swbuf_t *swbuf) {
+	struct render_state_t warm_up_state = *state;
+	for (unsigned int i = 1; i <= UI_SCREEN_COUNT; i++) {
+		warm_up_state.ui_screen = (state->ui_screen + i) % UI_SCREEN_COUNT;
+		swbuf_render_full_hd(&warm_up_state, swbuf);
+	}
+}
+
+/* Retained mode is off by default */
+void renderer_full_hd_set_retained(bool retained) {
+	renderer_retained = retained;
+}
+
+/* Rasterizes frames in horizontal bands on a pool of worker threads. A thread
+ * count of zero switches back to rendering on the calling thread. Must not be
+ * called while a frame is being rendered. */
+bool renderer_full_hd_set_tiled(unsigned int thread_count, unsigned int tile_count) {
+	tilerender_free(tiled_renderer);
+	tiled_renderer = NULL;
+	if (thread_count == 0) {
+		return true;
+	}
+	tiled_renderer = tilerender_create(thread_count, tile_count);
+	return tiled_renderer != NULL;
+}
+
+/* Registers the fonts the renderer uses. With a private fontconfig
+ * configuration, only the bundled fonts and the explicitly given extra font
+ * files (e.g., Roboto from the system) can be matched at all; anything else
+ * falls back to one of those. Fonts that cannot be added are only reported. */
+bool renderer_full_hd_load_fonts(bool private_fontconfig, char * const *extra_fonts, unsigned int extra_font_count) {
+	static const char *bundled_fonts[] = {
+		"../external/beon/beon-webfont.ttf",
+		"../external/instruction/Instruction.ttf",
+	};
+
+	if (private_fontconfig && !cairo_use_private_fontconfig()) {
+		return false;
+	}
+	for (unsigned int i = 0; i < sizeof(bundled_fonts) / sizeof(bundled_fonts[0]); i++) {
+		cairo_addfont(bundled_fonts[i]);
+	}
+	for (unsigned int i = 0; i < extra_font_count; i++) {
+		cairo_addfont(extra_fonts[i]);
+	}
+	return true;
+}
+
+void renderer_full_hd_get_stats(struct renderer_stats_t *stats) {
+	pthread_mutex_lock(&static_layer_mutex);
+	*stats = renderer_stats;
+	pthread_mutex_unlock(&static_layer_mutex);
+	if (highscore_table_cache) {
+		tablecache_get_stats(highscore_table_cache, &stats->highscore_table);
+	}
+	stats->layout_resolutions = main_screen_layout.resolutions + game_screen_layout.resolutions;
+}
 
-	} if (server_state->ui_screen == FINISH_SCREEN) {
+void renderer_full_hd_free(void) {
+	renderer_full_hd_set_tiled(0, 0);
+	tablecache_free(highscore_table_cache);
+	highscore_table_cache = NULL;
+	layout_invalidate(&main_screen_layout);
+	layout_invalidate(&game_screen_layout);
+	pthread_mutex_lock(&static_layer_mutex);
+	for (unsigned int i = 0; i < UI_SCREEN_COUNT; i++) {
+		free_swbuf(static_layers[i].swbuf);
+		static_layers[i].swbuf = NULL;
+		static_layers[i].valid = false;
 	}
+	pthread_mutex_unlock(&static_layer_mutex);
 }
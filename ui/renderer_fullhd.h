@@ -25,9 +25,26 @@
 
 #include "cyberblades-ui.h"
 #include "cairo.h"
+#include "tablecache.h"
+
+struct renderer_stats_t {
+	unsigned int static_layer_rebuilds;
+	unsigned int static_layer_reuses;
+	unsigned long long restored_pixels;
+	unsigned long long recorded_ops;
+	unsigned long long replayed_ops;
+	struct tablecache_stats_t highscore_table;
+	unsigned int layout_resolutions;
+};
 
 /*************** AUTO GENERATED SECTION FOLLOWS ***************/
-void swbuf_render_full_hd(const struct server_state_t *server_state, struct cairo_swbuf_t *swbuf);
+void swbuf_render_full_hd(const struct render_state_t *state, struct cairo_swbuf_t *swbuf);
+void renderer_full_hd_warm_up(const struct render_state_t *state, struct cairo_swbuf_t *swbuf);
+void renderer_full_hd_set_retained(bool retained);
+bool renderer_full_hd_set_tiled(unsigned int thread_count, unsigned int tile_count);
+bool renderer_full_hd_load_fonts(bool private_fontconfig, char * const *extra_fonts, unsigned int extra_font_count);
+void renderer_full_hd_get_stats(struct renderer_stats_t *stats);
+void renderer_full_hd_free(void);
 /***************  AUTO GENERATED SECTION ENDS   ***************/
 
 #endif
@@ -0,0 +1,51 @@
+/*
+	pibeatsaber - Beat Saber historian application that tracks players
+	Copyright (C) 2019-2019 Johannes Bauer
+
+	This file is part of pibeatsaber.
+
+	pibeatsaber is free software; you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation; this program is ONLY licensed under
+	version 3 of the License, later versions are explicitly excluded.
+
+	pibeatsaber is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+	Johannes Bauer <JohannesBauer@gmx.de>
+*/
+
+#include <sched.h>
+#include "seqlock.h"
+
+void seqlock_write_begin(struct seqlock_t *lock) {
+	unsigned int sequence = atomic_load_explicit(&lock->sequence, memory_order_relaxed);
+	atomic_store_explicit(&lock->sequence, sequence + 1, memory_order_relaxed);
+	atomic_thread_fence(memory_order_release);
+}
+
+void seqlock_write_end(struct seqlock_t *lock) {
+	unsigned int sequence = atomic_load_explicit(&lock->sequence, memory_order_relaxed);
+	atomic_store_explicit(&lock->sequence, sequence + 1, memory_order_release);
+}
+
+unsigned int seqlock_read_begin(struct seqlock_t *lock) {
+	while (true) {
+		unsigned int sequence = atomic_load_explicit(&lock->sequence, memory_order_acquire);
+		if ((sequence & 1) == 0) {
+			return sequence;
+		}
+		/* Writer is currently updating, let it finish */
+		sched_yield();
+	}
+}
+
+bool seqlock_read_retry(struct seqlock_t *lock, unsigned int start) {
+	atomic_thread_fence(memory_order_acquire);
+	return atomic_load_explicit(&lock->sequence, memory_order_relaxed) != start;
+}
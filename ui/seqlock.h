@@ -0,0 +1,47 @@
+/*
+	pibeatsaber - Beat Saber historian application that tracks players
+	Copyright (C) 2019-2019 Johannes Bauer
+
+	This file is part of pibeatsaber.
+
+	pibeatsaber is free software; you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation; this program is ONLY licensed under
+	version 3 of the License, later versions are explicitly excluded.
+
+	pibeatsaber is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+	Johannes Bauer <JohannesBauer@gmx.de>
+*/
+
+#ifndef __SEQLOCK_H__
+#define __SEQLOCK_H__
+
+#include <stdbool.h>
+#include <stdatomic.h>
+
+/* Sequence lock for a single writer (writers need to be serialized by some
+ * other means) and any number of readers. Readers never block the writer,
+ * they simply retry if they raced with an update. */
+struct seqlock_t {
+	atomic_uint sequence;
+};
+
+#define SEQLOCK_INITIALIZER		{ \
+	.sequence = ATOMIC_VAR_INIT(0),	\
+}
+
+/*************** AUTO GENERATED SECTION FOLLOWS ***************/
+void seqlock_write_begin(struct seqlock_t *lock);
+void seqlock_write_end(struct seqlock_t *lock);
+unsigned int seqlock_read_begin(struct seqlock_t *lock);
+bool seqlock_read_retry(struct seqlock_t *lock, unsigned int start);
+/***************  AUTO GENERATED SECTION ENDS   ***************/
+
+#endif
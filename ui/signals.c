@@ -22,6 +22,7 @@
 
 #include <stdio.h>
 #include <stddef.h>
+#include <stdint.h>
 #include <signal.h>
 #include <pthread.h>
 #include "ui_events.h"
@@ -31,17 +32,22 @@ static ui_event_cb_t ui_event_callback;
 static void *ui_callback_ctx;
 
 static void *signal_thread(void *csigno) {
-	ui_event_callback(EVENT_QUIT, NULL, ui_callback_ctx);
+	int signo = (intptr_t)csigno;
+	if (signo == SIGUSR1) {
+		ui_event_callback(EVENT_DUMP_STATS, NULL, ui_callback_ctx);
+	} else {
+		ui_event_callback(EVENT_QUIT, NULL, ui_callback_ctx);
+	}
 	return NULL;
 }
 
-static void sigint_handler(int signo) {
+static void signal_handler(int signo) {
 	/* Handle signal asynchronously */
 	pthread_attr_t attr;
 	pthread_attr_init(&attr);
 	pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
 	pthread_t thread;
-	pthread_create(&thread, &attr, signal_thread, NULL);
+	pthread_create(&thread, &attr, signal_thread, (void*)(intptr_t)signo);
 	pthread_attr_destroy(&attr);
 }
 
@@ -50,7 +56,7 @@ bool register_signal_handler(ui_event_cb_t event_callback, void *ctx) {
 	ui_callback_ctx = ctx;
 
 	struct sigaction action = {
-		.sa_handler = sigint_handler,
+		.sa_handler = signal_handler,
 		.sa_flags = SA_RESTART,
 	};
 	sigemptyset(&action.sa_mask);
@@ -58,5 +64,9 @@ bool register_signal_handler(ui_event_cb_t event_callback, void *ctx) {
 		perror("sigaction");
 		return false;
 	}
+	if (sigaction(SIGUSR1, &action, NULL)) {
+		perror("sigaction");
+		return false;
+	}
 	return true;
 }
@@ -0,0 +1,94 @@
+/*
+	pibeatsaber - Beat Saber historian application that tracks players
+	Copyright (C) 2019-2019 Johannes Bauer
+
+	This file is part of pibeatsaber.
+
+	pibeatsaber is free software; you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation; this program is ONLY licensed under
+	version 3 of the License, later versions are explicitly excluded.
+
+	pibeatsaber is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+	Johannes Bauer <JohannesBauer@gmx.de>
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "splash.h"
+
+struct splash_t *splash_open(const char *filename) {
+	int fd = open(filename, O_RDONLY);
+	if (fd == -1) {
+		perror(filename);
+		return NULL;
+	}
+
+	struct stat statbuf;
+	if (fstat(fd, &statbuf)) {
+		perror("fstat");
+		close(fd);
+		return NULL;
+	}
+	if (statbuf.st_size == 0) {
+		fprintf(stderr, "Splash image %s is empty.\n", filename);
+		close(fd);
+		return NULL;
+	}
+
+	void *data = mmap(NULL, statbuf.st_size, PROT_READ, MAP_PRIVATE | MAP_POPULATE, fd, 0);
+	close(fd);
+	if (data == MAP_FAILED) {
+		perror("mmap");
+		return NULL;
+	}
+
+	struct splash_t *splash = calloc(1, sizeof(struct splash_t));
+	if (!splash) {
+		perror("calloc");
+		munmap(data, statbuf.st_size);
+		return NULL;
+	}
+	splash->filename = filename;
+	splash->data = data;
+	splash->size = statbuf.st_size;
+	return splash;
+}
+
+/* Only displays that accept whole buffers in their native format can show a
+ * splash image. A file larger than the display (e.g., a framebuffer copy that
+ * includes the virtual screen area) is fine, the excess is ignored. */
+bool splash_show(const struct splash_t *splash, struct display_t *display) {
+	const size_t needed = (size_t)display->width * display->height * display->bits_per_pixel / 8;
+	if (splash->size < needed) {
+		fprintf(stderr, "Splash image %s has %zu bytes, but a %u x %u display at %u bpp needs %zu.\n", splash->filename, splash->size, display->width, display->height, display->bits_per_pixel, needed);
+		return false;
+	}
+	if (!display->calltable->blit_buffer || !display->calltable->blit_buffer(display, (uint32_t*)splash->data, display->width, display->height)) {
+		fprintf(stderr, "Display cannot show splash image %s.\n", splash->filename);
+		return false;
+	}
+	display_commit(display);
+	return true;
+}
+
+void splash_close(struct splash_t *splash) {
+	if (!splash) {
+		return;
+	}
+	if (munmap(splash->data, splash->size)) {
+		perror("munmap");
+	}
+	free(splash);
+}
@@ -0,0 +1,46 @@
+/*
+	pibeatsaber - Beat Saber historian application that tracks players
+	Copyright (C) 2019-2019 Johannes Bauer
+
+	This file is part of pibeatsaber.
+
+	pibeatsaber is free software; you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation; this program is ONLY licensed under
+	version 3 of the License, later versions are explicitly excluded.
+
+	pibeatsaber is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+	Johannes Bauer <JohannesBauer@gmx.de>
+*/
+
+#ifndef __SPLASH_H__
+#define __SPLASH_H__
+
+#include <stddef.h>
+#include <stdbool.h>
+#include "display.h"
+
+/* A pre-rendered image without any header, in the native pixel format of the
+ * display it is shown on (e.g., a raw frame dumped in headless mode or a copy
+ * of /dev/fb0). It is memory-mapped so that showing it only costs a single
+ * copy onto the display. */
+struct splash_t {
+	const char *filename;
+	void *data;
+	size_t size;
+};
+
+/*************** AUTO GENERATED SECTION FOLLOWS ***************/
+struct splash_t *splash_open(const char *filename);
+bool splash_show(const struct splash_t *splash, struct display_t *display);
+void splash_close(struct splash_t *splash);
+/***************  AUTO GENERATED SECTION ENDS   ***************/
+
+#endif
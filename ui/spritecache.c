@@ -0,0 +1,193 @@
+/*
+	pibeatsaber - Beat Saber historian application that tracks players
+	Copyright (C) 2019-2019 Johannes Bauer
+
+	This file is part of pibeatsaber.
+
+	pibeatsaber is free software; you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation; this program is ONLY licensed under
+	version 3 of the License, later versions are explicitly excluded.
+
+	pibeatsaber is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+	Johannes Bauer <JohannesBauer@gmx.de>
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <pthread.h>
+#include "spritecache.h"
+#include "colors.h"
+
+/* Large text such as the headings is expensive to rasterize, but is drawn
+ * identically in every frame. A sprite holds the text pre-rendered onto a
+ * transparent ARGB surface so that drawing it is a mere composite operation.
+ * Sprites are kept in most-recently-used order and the least recently used
+ * ones are evicted once the memory budget is exceeded.
+ *
+ * The sprite's top left pixel corresponds to the text's ink origin (pen
+ * position plus bearing) rounded down, minus SPRITECACHE_PADDING. Since the
+ * text is always drawn with its ink left edge on an integer coordinate and
+ * its baseline on an integer coordinate, compositing the sprite gives the
+ * same pixels as drawing the text directly. */
+static pthread_mutex_t spritecache_mutex = PTHREAD_MUTEX_INITIALIZER;
+static struct spritecache_entry_t *spritecache_head, *spritecache_tail;
+static struct spritecache_stats_t spritecache_stats;
+
+static void spritecache_unlink(struct spritecache_entry_t *entry) {
+	if (entry->prev) {
+		entry->prev->next = entry->next;
+	} else {
+		spritecache_head = entry->next;
+	}
+	if (entry->next) {
+		entry->next->prev = entry->prev;
+	} else {
+		spritecache_tail = entry->prev;
+	}
+	entry->prev = NULL;
+	entry->next = NULL;
+}
+
+static void spritecache_push_front(struct spritecache_entry_t *entry) {
+	entry->prev = NULL;
+	entry->next = spritecache_head;
+	if (spritecache_head) {
+		spritecache_head->prev = entry;
+	} else {
+		spritecache_tail = entry;
+	}
+	spritecache_head = entry;
+}
+
+/* Must be called with the lock held, moves a found entry to the front */
+static struct spritecache_entry_t *spritecache_lookup(const struct fontcache_entry_t *font, uint32_t color, const char *text) {
+	struct spritecache_entry_t *entry = spritecache_head;
+	while (entry) {
+		if ((entry->font == font) && (entry->color == color) && !strcmp(entry->text, text)) {
+			spritecache_unlink(entry);
+			spritecache_push_front(entry);
+			return entry;
+		}
+		entry = entry->next;
+	}
+	return NULL;
+}
+
+static void spritecache_free_entry(struct spritecache_entry_t *entry) {
+	spritecache_stats.entries--;
+	spritecache_stats.size_bytes -= entry->size_bytes;
+	cairo_surface_destroy(entry->surface);
+	free(entry);
+}
+
+static cairo_surface_t *spritecache_rasterize(const struct fontcache_entry_t *font, uint32_t color, const char *text, const cairo_text_extents_t *extents) {
+	const unsigned int width = ceil(extents->width) + (2 * SPRITECACHE_PADDING);
+	const unsigned int height = ceil(extents->height) + (2 * SPRITECACHE_PADDING) + 1;
+	cairo_surface_t *surface = cairo_image_surface_create(CAIRO_FORMAT_ARGB32, width, height);
+	if (cairo_surface_status(surface) != CAIRO_STATUS_SUCCESS) {
+		cairo_surface_destroy(surface);
+		return NULL;
+	}
+
+	cairo_t *ctx = cairo_create(surface);
+	cairo_set_scaled_font(ctx, font->scaled_font);
+	cairo_set_source_rgb(ctx, GET_R(color) / 255.0, GET_G(color) / 255.0, GET_B(color) / 255.0);
+	cairo_move_to(ctx, SPRITECACHE_PADDING - extents->x_bearing, SPRITECACHE_PADDING - floor(extents->y_bearing));
+	cairo_show_text(ctx, text);
+	cairo_destroy(ctx);
+	cairo_surface_flush(surface);
+	return surface;
+}
+
+/* Returns a new reference to the sprite that the caller needs to destroy
+ * after use, or NULL if the text cannot be cached. */
+cairo_surface_t *spritecache_get(const struct fontcache_entry_t *font, uint32_t color, const char *text, const cairo_text_extents_t *extents) {
+	if (strlen(text) > SPRITECACHE_MAX_TEXT_LENGTH) {
+		return NULL;
+	}
+
+	pthread_mutex_lock(&spritecache_mutex);
+	struct spritecache_entry_t *entry = spritecache_lookup(font, color, text);
+	if (entry) {
+		spritecache_stats.hits++;
+		cairo_surface_t *surface = cairo_surface_reference(entry->surface);
+		pthread_mutex_unlock(&spritecache_mutex);
+		return surface;
+	}
+	spritecache_stats.misses++;
+	pthread_mutex_unlock(&spritecache_mutex);
+
+	/* Rasterize outside of the lock, this is the expensive part */
+	cairo_surface_t *surface = spritecache_rasterize(font, color, text, extents);
+	if (!surface) {
+		return NULL;
+	}
+	const unsigned int size_bytes = cairo_image_surface_get_stride(surface) * cairo_image_surface_get_height(surface);
+	if (size_bytes > SPRITECACHE_BUDGET_BYTES) {
+		return surface;
+	}
+
+	entry = calloc(sizeof(struct spritecache_entry_t), 1);
+	if (!entry) {
+		perror("calloc");
+		return surface;
+	}
+	entry->font = font;
+	entry->color = color;
+	strcpy(entry->text, text);
+	entry->surface = cairo_surface_reference(surface);
+	entry->size_bytes = size_bytes;
+
+	pthread_mutex_lock(&spritecache_mutex);
+	struct spritecache_entry_t *existing = spritecache_lookup(font, color, text);
+	if (existing) {
+		/* Another thread rasterized the same sprite in the meantime, use that
+		 * one instead of inserting a duplicate */
+		spritecache_stats.misses--;
+		spritecache_stats.hits++;
+		cairo_surface_t *cached_surface = cairo_surface_reference(existing->surface);
+		pthread_mutex_unlock(&spritecache_mutex);
+		cairo_surface_destroy(entry->surface);
+		free(entry);
+		cairo_surface_destroy(surface);
+		return cached_surface;
+	}
+	while (spritecache_tail && (spritecache_stats.size_bytes + size_bytes > SPRITECACHE_BUDGET_BYTES)) {
+		struct spritecache_entry_t *victim = spritecache_tail;
+		spritecache_unlink(victim);
+		spritecache_free_entry(victim);
+		spritecache_stats.evictions++;
+	}
+	spritecache_push_front(entry);
+	spritecache_stats.entries++;
+	spritecache_stats.size_bytes += size_bytes;
+	pthread_mutex_unlock(&spritecache_mutex);
+	return surface;
+}
+
+void spritecache_get_stats(struct spritecache_stats_t *stats) {
+	pthread_mutex_lock(&spritecache_mutex);
+	*stats = spritecache_stats;
+	pthread_mutex_unlock(&spritecache_mutex);
+}
+
+/* Must be called before any of the fonts that are used as keys go away */
+void spritecache_flush(void) {
+	pthread_mutex_lock(&spritecache_mutex);
+	while (spritecache_head) {
+		struct spritecache_entry_t *entry = spritecache_head;
+		spritecache_unlink(entry);
+		spritecache_free_entry(entry);
+	}
+	pthread_mutex_unlock(&spritecache_mutex);
+}
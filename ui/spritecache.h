@@ -0,0 +1,57 @@
+/*
+	pibeatsaber - Beat Saber historian application that tracks players
+	Copyright (C) 2019-2019 Johannes Bauer
+
+	This file is part of pibeatsaber.
+
+	pibeatsaber is free software; you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation; this program is ONLY licensed under
+	version 3 of the License, later versions are explicitly excluded.
+
+	pibeatsaber is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+	Johannes Bauer <JohannesBauer@gmx.de>
+*/
+
+#ifndef __SPRITECACHE_H__
+#define __SPRITECACHE_H__
+
+#include <stdint.h>
+#include <cairo/cairo.h>
+#include "fontcache.h"
+
+#define SPRITECACHE_BUDGET_BYTES		(8 * 1024 * 1024)
+#define SPRITECACHE_MAX_TEXT_LENGTH		63
+#define SPRITECACHE_PADDING				1
+
+struct spritecache_entry_t {
+	const struct fontcache_entry_t *font;
+	uint32_t color;
+	char text[SPRITECACHE_MAX_TEXT_LENGTH + 1];
+	cairo_surface_t *surface;
+	unsigned int size_bytes;
+	struct spritecache_entry_t *prev, *next;
+};
+
+struct spritecache_stats_t {
+	unsigned int entries;
+	unsigned int size_bytes;
+	unsigned long long hits;
+	unsigned long long misses;
+	unsigned long long evictions;
+};
+
+/*************** AUTO GENERATED SECTION FOLLOWS ***************/
+cairo_surface_t *spritecache_get(const struct fontcache_entry_t *font, uint32_t color, const char *text, const cairo_text_extents_t *extents);
+void spritecache_get_stats(struct spritecache_stats_t *stats);
+void spritecache_flush(void);
+/***************  AUTO GENERATED SECTION ENDS   ***************/
+
+#endif
@@ -0,0 +1,138 @@
+/*
+	pibeatsaber - Beat Saber historian application that tracks players
+	Copyright (C) 2019-2019 Johannes Bauer
+
+	This file is part of pibeatsaber.
+
+	pibeatsaber is free software; you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation; this program is ONLY licensed under
+	version 3 of the License, later versions are explicitly excluded.
+
+	pibeatsaber is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+	Johannes Bauer <JohannesBauer@gmx.de>
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include "swapchain.h"
+
+struct swapchain_t *swapchain_create(unsigned int depth, unsigned int width, unsigned int height, unsigned int bits_per_pixel) {
+	if ((depth < SWAPCHAIN_MIN_DEPTH) || (depth > SWAPCHAIN_MAX_DEPTH)) {
+		fprintf(stderr, "Swap chain depth must be between %d and %d, %u requested.\n", SWAPCHAIN_MIN_DEPTH, SWAPCHAIN_MAX_DEPTH, depth);
+		return NULL;
+	}
+
+	struct swapchain_t *swapchain = calloc(sizeof(struct swapchain_t), 1);
+	if (!swapchain) {
+		perror("calloc");
+		return NULL;
+	}
+
+	pthread_mutex_init(&swapchain->mutex, NULL);
+	pthread_cond_init(&swapchain->cond, NULL);
+	swapchain->running = true;
+	swapchain->depth = depth;
+	for (unsigned int i = 0; i < depth; i++) {
+		swapchain->slots[i].swbuf = create_swbuf(width, height, bits_per_pixel);
+		if (!swapchain->slots[i].swbuf) {
+			swapchain_free(swapchain);
+			return NULL;
+		}
+	}
+	return swapchain;
+}
+
+static struct swapchain_slot_t *swapchain_find_oldest(struct swapchain_t *swapchain, enum swapchain_slot_state_t state) {
+	struct swapchain_slot_t *oldest = NULL;
+	for (unsigned int i = 0; i < swapchain->depth; i++) {
+		struct swapchain_slot_t *slot = &swapchain->slots[i];
+		if (slot->state != state) {
+			continue;
+		}
+		if (!oldest || ((int)(slot->sequence - oldest->sequence) < 0)) {
+			oldest = slot;
+		}
+	}
+	return oldest;
+}
+
+struct swapchain_slot_t *swapchain_acquire(struct swapchain_t *swapchain) {
+	pthread_mutex_lock(&swapchain->mutex);
+	struct swapchain_slot_t *slot = swapchain_find_oldest(swapchain, SLOT_FREE);
+	if (!slot) {
+		/* Presentation cannot keep up, throw away the stalest frame */
+		slot = swapchain_find_oldest(swapchain, SLOT_QUEUED);
+		swapchain->stats.dropped++;
+	}
+	slot->state = SLOT_RENDERING;
+	pthread_mutex_unlock(&swapchain->mutex);
+	return slot;
+}
+
+void swapchain_queue(struct swapchain_t *swapchain, struct swapchain_slot_t *slot) {
+	pthread_mutex_lock(&swapchain->mutex);
+	slot->state = SLOT_QUEUED;
+	slot->sequence = swapchain->next_sequence++;
+	swapchain->stats.queued++;
+	pthread_cond_signal(&swapchain->cond);
+	pthread_mutex_unlock(&swapchain->mutex);
+}
+
+struct swapchain_slot_t *swapchain_dequeue(struct swapchain_t *swapchain) {
+	struct swapchain_slot_t *slot = NULL;
+	pthread_mutex_lock(&swapchain->mutex);
+	while (true) {
+		slot = swapchain_find_oldest(swapchain, SLOT_QUEUED);
+		if (slot) {
+			slot->state = SLOT_PRESENTING;
+			break;
+		}
+		if (!swapchain->running) {
+			/* Stopped and everything that was queued has been presented */
+			break;
+		}
+		pthread_cond_wait(&swapchain->cond, &swapchain->mutex);
+	}
+	pthread_mutex_unlock(&swapchain->mutex);
+	return slot;
+}
+
+void swapchain_release(struct swapchain_t *swapchain, struct swapchain_slot_t *slot) {
+	pthread_mutex_lock(&swapchain->mutex);
+	slot->state = SLOT_FREE;
+	swapchain->stats.presented++;
+	pthread_mutex_unlock(&swapchain->mutex);
+}
+
+void swapchain_get_stats(struct swapchain_t *swapchain, struct swapchain_stats_t *stats) {
+	pthread_mutex_lock(&swapchain->mutex);
+	*stats = swapchain->stats;
+	pthread_mutex_unlock(&swapchain->mutex);
+}
+
+void swapchain_stop(struct swapchain_t *swapchain) {
+	pthread_mutex_lock(&swapchain->mutex);
+	swapchain->running = false;
+	pthread_cond_broadcast(&swapchain->cond);
+	pthread_mutex_unlock(&swapchain->mutex);
+}
+
+void swapchain_free(struct swapchain_t *swapchain) {
+	if (!swapchain) {
+		return;
+	}
+	for (unsigned int i = 0; i < swapchain->depth; i++) {
+		free_swbuf(swapchain->slots[i].swbuf);
+	}
+	pthread_mutex_destroy(&swapchain->mutex);
+	pthread_cond_destroy(&swapchain->cond);
+	free(swapchain);
+}
@@ -0,0 +1,80 @@
+/*
+	pibeatsaber - Beat Saber historian application that tracks players
+	Copyright (C) 2019-2019 Johannes Bauer
+
+	This file is part of pibeatsaber.
+
+	pibeatsaber is free software; you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation; this program is ONLY licensed under
+	version 3 of the License, later versions are explicitly excluded.
+
+	pibeatsaber is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+	Johannes Bauer <JohannesBauer@gmx.de>
+*/
+
+#ifndef __SWAPCHAIN_H__
+#define __SWAPCHAIN_H__
+
+#include <stdbool.h>
+#include <pthread.h>
+#include "cairo.h"
+
+#define SWAPCHAIN_MIN_DEPTH			2
+#define SWAPCHAIN_MAX_DEPTH			8
+
+enum swapchain_slot_state_t {
+	SLOT_FREE,
+	SLOT_RENDERING,
+	SLOT_QUEUED,
+	SLOT_PRESENTING,
+};
+
+struct swapchain_slot_t {
+	struct cairo_swbuf_t *swbuf;
+	enum swapchain_slot_state_t state;
+	unsigned int sequence;
+	unsigned int frameno;
+	unsigned int generation;
+	unsigned int historian_msgno;
+};
+
+struct swapchain_stats_t {
+	unsigned int queued;
+	unsigned int presented;
+	unsigned int dropped;
+};
+
+/* Ring of software buffers shared between exactly one render thread (which
+ * acquires and queues buffers) and exactly one present thread (which
+ * dequeues and releases them). The renderer never blocks: if no buffer is
+ * free, the oldest queued frame is dropped and its buffer reused. */
+struct swapchain_t {
+	pthread_mutex_t mutex;
+	pthread_cond_t cond;
+	bool running;
+	unsigned int depth;
+	unsigned int next_sequence;
+	struct swapchain_stats_t stats;
+	struct swapchain_slot_t slots[SWAPCHAIN_MAX_DEPTH];
+};
+
+/*************** AUTO GENERATED SECTION FOLLOWS ***************/
+struct swapchain_t *swapchain_create(unsigned int depth, unsigned int width, unsigned int height, unsigned int bits_per_pixel);
+struct swapchain_slot_t *swapchain_acquire(struct swapchain_t *swapchain);
+void swapchain_queue(struct swapchain_t *swapchain, struct swapchain_slot_t *slot);
+struct swapchain_slot_t *swapchain_dequeue(struct swapchain_t *swapchain);
+void swapchain_release(struct swapchain_t *swapchain, struct swapchain_slot_t *slot);
+void swapchain_get_stats(struct swapchain_t *swapchain, struct swapchain_stats_t *stats);
+void swapchain_stop(struct swapchain_t *swapchain);
+void swapchain_free(struct swapchain_t *swapchain);
+/***************  AUTO GENERATED SECTION ENDS   ***************/
+
+#endif
@@ -0,0 +1,193 @@
+/*
+	pibeatsaber - Beat Saber historian application that tracks players
+	Copyright (C) 2019-2019 Johannes Bauer
+
+	This file is part of pibeatsaber.
+
+	pibeatsaber is free software; you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation; this program is ONLY licensed under
+	version 3 of the License, later versions are explicitly excluded.
+
+	pibeatsaber is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+	Johannes Bauer <JohannesBauer@gmx.de>
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "tablecache.h"
+
+struct tablecache_t *tablecache_create(void) {
+	struct tablecache_t *cache = calloc(sizeof(struct tablecache_t), 1);
+	if (!cache) {
+		perror("calloc");
+		return NULL;
+	}
+	return cache;
+}
+
+/* Makes sure the cache surface fits the table and renders with the target's
+ * profile; if either changed, the cache starts over */
+static bool tablecache_prepare(struct tablecache_t *cache, const struct table_definition_t *table, unsigned int table_width, unsigned int table_height, enum render_profile_t profile) {
+	if (cache->swbuf && (cache->swbuf->profile == profile) && (cache->columns == table->columns) && (cache->rows == table->rows) && (cache->table_width == table_width) && (cache->table_height == table_height) && (cache->margin == table->row_height)) {
+		return true;
+	}
+
+	free_swbuf(cache->swbuf);
+	cache->valid = false;
+	cache->columns = table->columns;
+	cache->rows = table->rows;
+	cache->table_width = table_width;
+	cache->table_height = table_height;
+	cache->margin = table->row_height;
+	cache->swbuf = create_swbuf(table_width + (2 * cache->margin), table_height + (2 * cache->margin), 32);
+	if (!cache->swbuf) {
+		return false;
+	}
+	swbuf_set_profile(cache->swbuf, profile);
+	damage_init(&cache->coverage, cache->swbuf->width, cache->swbuf->height);
+	for (unsigned int i = 0; i < TABLECACHE_MAX_CELLS; i++) {
+		cache->cells[i].valid = false;
+		cache->cells[i].has_ink = false;
+	}
+	return true;
+}
+
+static void tablecache_clear(struct tablecache_t *cache, const struct damage_t *region) {
+	cairo_t *ctx = cache->swbuf->ctx;
+	cairo_save(ctx);
+	cairo_set_operator(ctx, CAIRO_OPERATOR_CLEAR);
+	for (unsigned int i = 0; i < region->count; i++) {
+		cairo_rectangle(ctx, region->rects[i].x, region->rects[i].y, region->rects[i].width, region->rects[i].height);
+	}
+	cairo_fill(ctx);
+	cairo_restore(ctx);
+}
+
+static void tablecache_draw_cell_clipped(struct tablecache_t *cache, const struct font_placement_t *placement, const char *text, const struct damage_t *clip) {
+	cairo_t *ctx = cache->swbuf->ctx;
+	cairo_save(ctx);
+	for (unsigned int i = 0; i < clip->count; i++) {
+		cairo_rectangle(ctx, clip->rects[i].x, clip->rects[i].y, clip->rects[i].width, clip->rects[i].height);
+	}
+	cairo_clip(ctx);
+	swbuf_text(cache->swbuf, placement, "%s", text);
+	cairo_restore(ctx);
+}
+
+static void tablecache_update(struct tablecache_t *cache, const struct table_definition_t *table, void *ctx) {
+	struct font_placement_t placements[TABLECACHE_MAX_CELLS];
+	bool changed[TABLECACHE_MAX_CELLS];
+	unsigned int changed_count = 0;
+
+	/* Everything that changed cells covered before needs to be wiped */
+	struct damage_t dirty;
+	damage_init(&dirty, cache->swbuf->width, cache->swbuf->height);
+
+	unsigned int base_x = cache->margin;
+	for (unsigned int x = 0; x < table->columns; x++) {
+		for (unsigned int y = 0; y < table->rows; y++) {
+			const unsigned int index = (x * table->rows) + y;
+			struct tablecache_cell_t *cell = &cache->cells[index];
+			struct font_placement_t *placement = &placements[index];
+			*placement = table->font_default;
+			placement->placement.xoffset = base_x;
+			placement->placement.yoffset = cache->margin + (table->row_height * y);
+
+			char buffer[TABLECACHE_MAX_TEXT_LENGTH + 1];
+			buffer[0] = 0;
+			table->rendering_callback(buffer, sizeof(buffer), placement, x, y, ctx);
+
+			changed[index] = !cell->valid || strcmp(cell->text, buffer) || (cell->font_color != placement->font_color) || (cell->font_bold != placement->font_bold);
+			if (changed[index]) {
+				if (cell->has_ink) {
+					damage_add(&dirty, cell->ink.x, cell->ink.y, cell->ink.width, cell->ink.height);
+				}
+				strcpy(cell->text, buffer);
+				cell->font_color = placement->font_color;
+				cell->font_bold = placement->font_bold;
+				cell->valid = true;
+				changed_count++;
+				cache->stats.cell_misses++;
+			} else {
+				cache->stats.cell_hits++;
+			}
+		}
+		base_x += table->column_widths[x];
+	}
+	if (!changed_count) {
+		return;
+	}
+
+	tablecache_clear(cache, &dirty);
+	for (unsigned int index = 0; index < table->columns * table->rows; index++) {
+		struct tablecache_cell_t *cell = &cache->cells[index];
+		if (changed[index]) {
+			damage_reset(&cache->swbuf->damage);
+			swbuf_text(cache->swbuf, &placements[index], "%s", cell->text);
+			cell->has_ink = (cache->swbuf->damage.count > 0);
+			if (cell->has_ink) {
+				cell->ink = cache->swbuf->damage.rects[0];
+			}
+		} else if (cell->has_ink && damage_intersects(&dirty, &cell->ink)) {
+			/* Partly wiped because text of a neighbor overlapped it */
+			tablecache_draw_cell_clipped(cache, &placements[index], cell->text, &dirty);
+		}
+	}
+
+	damage_reset(&cache->coverage);
+	for (unsigned int index = 0; index < table->columns * table->rows; index++) {
+		const struct tablecache_cell_t *cell = &cache->cells[index];
+		if (cell->has_ink) {
+			damage_add(&cache->coverage, cell->ink.x, cell->ink.y, cell->ink.width, cell->ink.height);
+		}
+	}
+	cache->serial++;
+}
+
+/* Draws the table with its top left corner at (x, y). Returns false if the
+ * table cannot be cached, in which case the caller needs to draw it. */
+bool tablecache_render(struct tablecache_t *cache, struct cairo_swbuf_t *surface, const struct table_definition_t *table, void *ctx, int x, int y) {
+	if (table->columns * table->rows > TABLECACHE_MAX_CELLS) {
+		return false;
+	}
+
+	unsigned int table_width = 0;
+	for (unsigned int i = 0; i < table->columns; i++) {
+		table_width += table->column_widths[i];
+	}
+	if (!tablecache_prepare(cache, table, table_width, table->row_height * table->rows, surface->profile)) {
+		return false;
+	}
+
+	if (cache->valid && table->version && (cache->version == table->version)) {
+		cache->stats.table_hits++;
+	} else {
+		tablecache_update(cache, table, ctx);
+		cache->version = table->version;
+		cache->valid = true;
+	}
+	cairo_surface_flush(cache->swbuf->surface);
+	swbuf_surface(surface, cache->swbuf->surface, cache->serial, x - cache->margin, y - cache->margin, &cache->coverage);
+	return true;
+}
+
+void tablecache_get_stats(const struct tablecache_t *cache, struct tablecache_stats_t *stats) {
+	*stats = cache->stats;
+}
+
+void tablecache_free(struct tablecache_t *cache) {
+	if (!cache) {
+		return;
+	}
+	free_swbuf(cache->swbuf);
+	free(cache);
+}
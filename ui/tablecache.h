@@ -0,0 +1,74 @@
+/*
+	pibeatsaber - Beat Saber historian application that tracks players
+	Copyright (C) 2019-2019 Johannes Bauer
+
+	This file is part of pibeatsaber.
+
+	pibeatsaber is free software; you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation; this program is ONLY licensed under
+	version 3 of the License, later versions are explicitly excluded.
+
+	pibeatsaber is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+	Johannes Bauer <JohannesBauer@gmx.de>
+*/
+
+#ifndef __TABLECACHE_H__
+#define __TABLECACHE_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "cairo.h"
+#include "damage.h"
+
+#define TABLECACHE_MAX_CELLS			128
+#define TABLECACHE_MAX_TEXT_LENGTH		255
+
+struct tablecache_cell_t {
+	bool valid;
+	char text[TABLECACHE_MAX_TEXT_LENGTH + 1];
+	uint32_t font_color;
+	bool font_bold;
+	bool has_ink;
+	struct damage_rect_t ink;
+};
+
+struct tablecache_stats_t {
+	unsigned long long table_hits;
+	unsigned long long cell_hits;
+	unsigned long long cell_misses;
+};
+
+/* Keeps a rendered table on a transparent surface of its own, together with
+ * what every cell showed. Only cells whose text or style changed are drawn
+ * again; if the caller's data version did not change, even formatting the
+ * cells is skipped. The surface extends beyond the table by a margin so that
+ * descenders and overlong text are not cut off. */
+struct tablecache_t {
+	bool valid;
+	unsigned int version;
+	unsigned int serial;
+	unsigned int columns, rows;
+	unsigned int table_width, table_height;
+	unsigned int margin;
+	struct cairo_swbuf_t *swbuf;
+	struct damage_t coverage;
+	struct tablecache_stats_t stats;
+	struct tablecache_cell_t cells[TABLECACHE_MAX_CELLS];
+};
+
+/*************** AUTO GENERATED SECTION FOLLOWS ***************/
+struct tablecache_t *tablecache_create(void);
+bool tablecache_render(struct tablecache_t *cache, struct cairo_swbuf_t *surface, const struct table_definition_t *table, void *ctx, int x, int y);
+void tablecache_get_stats(const struct tablecache_t *cache, struct tablecache_stats_t *stats);
+void tablecache_free(struct tablecache_t *cache);
+/***************  AUTO GENERATED SECTION ENDS   ***************/
+
+#endif
@@ -0,0 +1,168 @@
+/*
+	pibeatsaber - Beat Saber historian application that tracks players
+	Copyright (C) 2019-2019 Johannes Bauer
+
+	This file is part of pibeatsaber.
+
+	pibeatsaber is free software; you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation; this program is ONLY licensed under
+	version 3 of the License, later versions are explicitly excluded.
+
+	pibeatsaber is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+	Johannes Bauer <JohannesBauer@gmx.de>
+*/
+
+#include <stdio.h>
+#include <stdbool.h>
+#include <string.h>
+#include <pthread.h>
+#include "textcache.h"
+
+/* Measuring a string with cairo requires converting it to glyphs, which is
+ * wasteful for labels and numbers that are drawn identically frame after
+ * frame. Measured extents are therefore kept in a fixed-size LRU cache keyed
+ * by the scaled font and the text. All entries are allocated statically, so
+ * the memory footprint is bounded; texts longer than
+ * TEXTCACHE_MAX_TEXT_LENGTH are measured every time. */
+static pthread_mutex_t textcache_mutex = PTHREAD_MUTEX_INITIALIZER;
+static struct textcache_entry_t textcache_entries[TEXTCACHE_ENTRY_COUNT];
+static struct textcache_entry_t *textcache_buckets[TEXTCACHE_BUCKET_COUNT];
+static struct textcache_entry_t *textcache_lru_head, *textcache_lru_tail;
+static struct textcache_stats_t textcache_stats;
+static bool textcache_initialized;
+
+static uint32_t textcache_hash(const struct fontcache_entry_t *font, const char *text, unsigned int text_length) {
+	/* FNV-1a over the text, seeded with the font pointer */
+	uint32_t hash = 0x811c9dc5 ^ (uint32_t)((uintptr_t)font >> 4);
+	for (unsigned int i = 0; i < text_length; i++) {
+		hash = (hash ^ (uint8_t)text[i]) * 0x01000193;
+	}
+	return hash;
+}
+
+static void textcache_lru_unlink(struct textcache_entry_t *entry) {
+	if (entry->lru_prev) {
+		entry->lru_prev->lru_next = entry->lru_next;
+	} else {
+		textcache_lru_head = entry->lru_next;
+	}
+	if (entry->lru_next) {
+		entry->lru_next->lru_prev = entry->lru_prev;
+	} else {
+		textcache_lru_tail = entry->lru_prev;
+	}
+	entry->lru_prev = NULL;
+	entry->lru_next = NULL;
+}
+
+static void textcache_lru_push_front(struct textcache_entry_t *entry) {
+	entry->lru_prev = NULL;
+	entry->lru_next = textcache_lru_head;
+	if (textcache_lru_head) {
+		textcache_lru_head->lru_prev = entry;
+	} else {
+		textcache_lru_tail = entry;
+	}
+	textcache_lru_head = entry;
+}
+
+static void textcache_bucket_unlink(struct textcache_entry_t *entry) {
+	struct textcache_entry_t **link = &textcache_buckets[entry->hash % TEXTCACHE_BUCKET_COUNT];
+	while (*link) {
+		if (*link == entry) {
+			*link = entry->hash_next;
+			break;
+		}
+		link = &(*link)->hash_next;
+	}
+	entry->hash_next = NULL;
+}
+
+/* Must be called with the mutex held */
+static void textcache_reset(void) {
+	memset(textcache_entries, 0, sizeof(textcache_entries));
+	memset(textcache_buckets, 0, sizeof(textcache_buckets));
+	textcache_lru_head = NULL;
+	textcache_lru_tail = NULL;
+	for (unsigned int i = 0; i < TEXTCACHE_ENTRY_COUNT; i++) {
+		textcache_lru_push_front(&textcache_entries[i]);
+	}
+	textcache_stats.entries = 0;
+	textcache_initialized = true;
+}
+
+void textcache_get_extents(const struct fontcache_entry_t *font, const char *text, cairo_text_extents_t *extents) {
+	unsigned int text_length = strlen(text);
+	if (text_length > TEXTCACHE_MAX_TEXT_LENGTH) {
+		pthread_mutex_lock(&textcache_mutex);
+		textcache_stats.uncacheable++;
+		pthread_mutex_unlock(&textcache_mutex);
+		cairo_scaled_font_text_extents(font->scaled_font, text, extents);
+		return;
+	}
+
+	uint32_t hash = textcache_hash(font, text, text_length);
+	pthread_mutex_lock(&textcache_mutex);
+	if (!textcache_initialized) {
+		textcache_reset();
+	}
+
+	struct textcache_entry_t *entry = textcache_buckets[hash % TEXTCACHE_BUCKET_COUNT];
+	while (entry) {
+		if ((entry->hash == hash) && (entry->font == font) && !strcmp(entry->text, text)) {
+			break;
+		}
+		entry = entry->hash_next;
+	}
+
+	if (entry) {
+		textcache_stats.hits++;
+		textcache_lru_unlink(entry);
+		textcache_lru_push_front(entry);
+		*extents = entry->extents;
+		pthread_mutex_unlock(&textcache_mutex);
+		return;
+	}
+
+	/* Miss: recycle the least recently used entry */
+	textcache_stats.misses++;
+	entry = textcache_lru_tail;
+	textcache_lru_unlink(entry);
+	if (entry->font) {
+		textcache_stats.evictions++;
+		textcache_bucket_unlink(entry);
+	} else {
+		textcache_stats.entries++;
+	}
+
+	cairo_scaled_font_text_extents(font->scaled_font, text, &entry->extents);
+	entry->font = font;
+	entry->hash = hash;
+	memcpy(entry->text, text, text_length + 1);
+	entry->hash_next = textcache_buckets[hash % TEXTCACHE_BUCKET_COUNT];
+	textcache_buckets[hash % TEXTCACHE_BUCKET_COUNT] = entry;
+	textcache_lru_push_front(entry);
+	*extents = entry->extents;
+	pthread_mutex_unlock(&textcache_mutex);
+}
+
+void textcache_get_stats(struct textcache_stats_t *stats) {
+	pthread_mutex_lock(&textcache_mutex);
+	*stats = textcache_stats;
+	pthread_mutex_unlock(&textcache_mutex);
+}
+
+/* Must be called before any of the fonts that are used as keys go away */
+void textcache_flush(void) {
+	pthread_mutex_lock(&textcache_mutex);
+	textcache_reset();
+	pthread_mutex_unlock(&textcache_mutex);
+}
@@ -0,0 +1,57 @@
+/*
+	pibeatsaber - Beat Saber historian application that tracks players
+	Copyright (C) 2019-2019 Johannes Bauer
+
+	This file is part of pibeatsaber.
+
+	pibeatsaber is free software; you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation; this program is ONLY licensed under
+	version 3 of the License, later versions are explicitly excluded.
+
+	pibeatsaber is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+	Johannes Bauer <JohannesBauer@gmx.de>
+*/
+
+#ifndef __TEXTCACHE_H__
+#define __TEXTCACHE_H__
+
+#include <stdint.h>
+#include <cairo/cairo.h>
+#include "fontcache.h"
+
+#define TEXTCACHE_ENTRY_COUNT			512
+#define TEXTCACHE_BUCKET_COUNT			1024
+#define TEXTCACHE_MAX_TEXT_LENGTH		63
+
+struct textcache_entry_t {
+	const struct fontcache_entry_t *font;
+	uint32_t hash;
+	char text[TEXTCACHE_MAX_TEXT_LENGTH + 1];
+	cairo_text_extents_t extents;
+	struct textcache_entry_t *hash_next;
+	struct textcache_entry_t *lru_prev, *lru_next;
+};
+
+struct textcache_stats_t {
+	unsigned int entries;
+	unsigned long long hits;
+	unsigned long long misses;
+	unsigned long long evictions;
+	unsigned long long uncacheable;
+};
+
+/*************** AUTO GENERATED SECTION FOLLOWS ***************/
+void textcache_get_extents(const struct fontcache_entry_t *font, const char *text, cairo_text_extents_t *extents);
+void textcache_get_stats(struct textcache_stats_t *stats);
+void textcache_flush(void);
+/***************  AUTO GENERATED SECTION ENDS   ***************/
+
+#endif
@@ -0,0 +1,165 @@
+/*
+	pibeatsaber - Beat Saber historian application that tracks players
+	Copyright (C) 2019-2019 Johannes Bauer
+
+	This file is part of pibeatsaber.
+
+	pibeatsaber is free software; you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation; this program is ONLY licensed under
+	version 3 of the License, later versions are explicitly excluded.
+
+	pibeatsaber is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+	Johannes Bauer <JohannesBauer@gmx.de>
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include "tilerender.h"
+
+static void tilerender_process_tile(struct tilerender_t *tiles, struct tilerender_tile_t *tile) {
+	tile->replayed = displaylist_replay(tiles->displaylist, tile->view, &tile->region);
+	cairo_surface_flush(tile->view->surface);
+}
+
+static void *tilerender_thread_fnc(void *vtiles) {
+	struct tilerender_t *tiles = (struct tilerender_t*)vtiles;
+	pthread_mutex_lock(&tiles->mutex);
+	while (true) {
+		while (tiles->running && (tiles->next_tile >= tiles->tile_count)) {
+			pthread_cond_wait(&tiles->work_cond, &tiles->mutex);
+		}
+		if (!tiles->running) {
+			break;
+		}
+
+		struct tilerender_tile_t *tile = &tiles->tiles[tiles->next_tile++];
+		pthread_mutex_unlock(&tiles->mutex);
+		tilerender_process_tile(tiles, tile);
+		pthread_mutex_lock(&tiles->mutex);
+
+		tiles->finished_tiles++;
+		if (tiles->finished_tiles == tiles->tile_count) {
+			pthread_cond_signal(&tiles->done_cond);
+		}
+	}
+	pthread_mutex_unlock(&tiles->mutex);
+	return NULL;
+}
+
+/* Parses "threads[:tiles]" */
+bool tilerender_parse_spec(const char *spec, unsigned int *thread_count, unsigned int *tile_count) {
+	unsigned int threads, tiles = TILERENDER_DEFAULT_TILES;
+	if (sscanf(spec, "%u:%u", &threads, &tiles) < 1) {
+		return false;
+	}
+	if ((threads < 1) || (threads > TILERENDER_MAX_THREADS) || (tiles < 1) || (tiles > TILERENDER_MAX_TILES)) {
+		return false;
+	}
+	*thread_count = threads;
+	*tile_count = tiles;
+	return true;
+}
+
+struct tilerender_t *tilerender_create(unsigned int thread_count, unsigned int tile_count) {
+	if ((thread_count < 1) || (thread_count > TILERENDER_MAX_THREADS)) {
+		fprintf(stderr, "Tiled rendering requires between 1 and %d threads, %u requested.\n", TILERENDER_MAX_THREADS, thread_count);
+		return NULL;
+	}
+	if ((tile_count < 1) || (tile_count > TILERENDER_MAX_TILES)) {
+		fprintf(stderr, "Tiled rendering requires between 1 and %d tiles, %u requested.\n", TILERENDER_MAX_TILES, tile_count);
+		return NULL;
+	}
+
+	struct tilerender_t *tiles = calloc(sizeof(struct tilerender_t), 1);
+	if (!tiles) {
+		perror("calloc");
+		return NULL;
+	}
+
+	pthread_mutex_init(&tiles->mutex, NULL);
+	pthread_cond_init(&tiles->work_cond, NULL);
+	pthread_cond_init(&tiles->done_cond, NULL);
+	tiles->running = true;
+	tiles->tile_count = tile_count;
+	tiles->next_tile = tile_count;
+	for (unsigned int i = 0; i < thread_count; i++) {
+		if (pthread_create(&tiles->threads[i], NULL, tilerender_thread_fnc, tiles)) {
+			perror("pthread_create");
+			tilerender_free(tiles);
+			return NULL;
+		}
+		tiles->thread_count++;
+	}
+	return tiles;
+}
+
+/* Replays the given region of the display list's current frame onto the
+ * buffer, band by band. Blocks until all bands are done and returns the
+ * number of operations drawn, summed over all bands. */
+unsigned int tilerender_replay(struct tilerender_t *tiles, const struct displaylist_t *displaylist, struct cairo_swbuf_t *swbuf, const struct damage_t *region) {
+	const unsigned int band_height = (swbuf->height + tiles->tile_count - 1) / tiles->tile_count;
+	for (unsigned int i = 0; i < tiles->tile_count; i++) {
+		struct tilerender_tile_t *tile = &tiles->tiles[i];
+		tile->view = create_swbuf_view(swbuf);
+		if (!tile->view) {
+			while (i--) {
+				free_swbuf(tiles->tiles[i].view);
+			}
+			return displaylist_replay(displaylist, swbuf, region);
+		}
+		const struct damage_rect_t band = {
+			.x = 0,
+			.y = i * band_height,
+			.width = swbuf->width,
+			.height = band_height,
+		};
+		damage_init(&tile->region, swbuf->width, swbuf->height);
+		damage_add_clipped(&tile->region, region, &band);
+		tile->replayed = 0;
+	}
+
+	pthread_mutex_lock(&tiles->mutex);
+	tiles->displaylist = displaylist;
+	tiles->finished_tiles = 0;
+	tiles->next_tile = 0;
+	pthread_cond_broadcast(&tiles->work_cond);
+	while (tiles->finished_tiles < tiles->tile_count) {
+		pthread_cond_wait(&tiles->done_cond, &tiles->mutex);
+	}
+	tiles->displaylist = NULL;
+	pthread_mutex_unlock(&tiles->mutex);
+
+	unsigned int replayed = 0;
+	for (unsigned int i = 0; i < tiles->tile_count; i++) {
+		replayed += tiles->tiles[i].replayed;
+		free_swbuf(tiles->tiles[i].view);
+		tiles->tiles[i].view = NULL;
+	}
+	cairo_surface_mark_dirty(swbuf->surface);
+	return replayed;
+}
+
+void tilerender_free(struct tilerender_t *tiles) {
+	if (!tiles) {
+		return;
+	}
+	pthread_mutex_lock(&tiles->mutex);
+	tiles->running = false;
+	pthread_cond_broadcast(&tiles->work_cond);
+	pthread_mutex_unlock(&tiles->mutex);
+	for (unsigned int i = 0; i < tiles->thread_count; i++) {
+		pthread_join(tiles->threads[i], NULL);
+	}
+	pthread_cond_destroy(&tiles->done_cond);
+	pthread_cond_destroy(&tiles->work_cond);
+	pthread_mutex_destroy(&tiles->mutex);
+	free(tiles);
+}
@@ -0,0 +1,67 @@
+/*
+	pibeatsaber - Beat Saber historian application that tracks players
+	Copyright (C) 2019-2019 Johannes Bauer
+
+	This file is part of pibeatsaber.
+
+	pibeatsaber is free software; you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation; this program is ONLY licensed under
+	version 3 of the License, later versions are explicitly excluded.
+
+	pibeatsaber is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+	Johannes Bauer <JohannesBauer@gmx.de>
+*/
+
+#ifndef __TILERENDER_H__
+#define __TILERENDER_H__
+
+#include <stdbool.h>
+#include <pthread.h>
+#include "cairo.h"
+#include "damage.h"
+#include "displaylist.h"
+
+#define TILERENDER_MAX_THREADS		16
+#define TILERENDER_MAX_TILES		64
+#define TILERENDER_DEFAULT_TILES	8
+
+struct tilerender_tile_t {
+	struct cairo_swbuf_t *view;
+	struct damage_t region;
+	unsigned int replayed;
+};
+
+/* Worker pool that replays a recorded frame in horizontal bands. Every band
+ * is drawn through its own Cairo context and clipped to the band, so no two
+ * workers ever touch the same pixel. */
+struct tilerender_t {
+	pthread_mutex_t mutex;
+	pthread_cond_t work_cond;
+	pthread_cond_t done_cond;
+	bool running;
+	unsigned int thread_count;
+	unsigned int tile_count;
+	pthread_t threads[TILERENDER_MAX_THREADS];
+
+	const struct displaylist_t *displaylist;
+	unsigned int next_tile;
+	unsigned int finished_tiles;
+	struct tilerender_tile_t tiles[TILERENDER_MAX_TILES];
+};
+
+/*************** AUTO GENERATED SECTION FOLLOWS ***************/
+bool tilerender_parse_spec(const char *spec, unsigned int *thread_count, unsigned int *tile_count);
+struct tilerender_t *tilerender_create(unsigned int thread_count, unsigned int tile_count);
+unsigned int tilerender_replay(struct tilerender_t *tiles, const struct displaylist_t *displaylist, struct cairo_swbuf_t *swbuf, const struct damage_t *region);
+void tilerender_free(struct tilerender_t *tiles);
+/***************  AUTO GENERATED SECTION ENDS   ***************/
+
+#endif
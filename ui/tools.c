@@ -23,6 +23,7 @@
 #include <stdio.h>
 #include <stddef.h>
 #include <sys/time.h>
+#include <time.h>
 #include <string.h>
 #include "tools.h"
 
@@ -32,6 +33,12 @@ double now(void) {
 	return tv.tv_sec + (1e-6 * tv.tv_usec);
 }
 
+uint64_t now_monotonic_ns(void) {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ((uint64_t)ts.tv_sec * 1000000000) + ts.tv_nsec;
+}
+
 void add_timespec_offset(struct timespec *timespec, int32_t offset_milliseconds) {
 	int32_t offset_full_seconds = offset_milliseconds / 1000;
 	int32_t offset_full_nanoseconds = 1000000 * (offset_milliseconds % 1000);
@@ -29,6 +29,7 @@
 
 /*************** AUTO GENERATED SECTION FOLLOWS ***************/
 double now(void);
+uint64_t now_monotonic_ns(void);
 void add_timespec_offset(struct timespec *timespec, int32_t offset_milliseconds);
 void get_timespec_now(struct timespec *timespec);
 void get_abs_timespec_offset(struct timespec *timespec, int32_t offset_milliseconds);
@@ -32,6 +32,7 @@ enum ui_eventtype_t {
 	EVENT_TEXTDATA,
 	EVENT_HISTORIAN_MESSAGE,
 	EVENT_HISTORIAN_STATECHG,
+	EVENT_DUMP_STATS,
 };
 
 struct ui_event_keypress_t {
@@ -47,6 +48,7 @@ struct historian_t;
 
 struct ui_event_historian_msg_t {
 	struct historian_t *historian;
+	unsigned int msgno;
 	struct jsondom_t* json;
 };
 